@@ -0,0 +1,72 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef INCLUDE_BOUNDARY_STATISTICS_H_
+#define INCLUDE_BOUNDARY_STATISTICS_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "corpus.h"
+
+namespace morfessor {
+
+/// Branching entropy at every position inside the words of a corpus, used to
+/// guess morph boundaries before training. The words are sorted forwards
+/// and backwards, and each run of words sharing a prefix (or suffix) gives
+/// the entropy of the letter that follows (or precedes) it. A boundary is
+/// likely where many different letters can follow the prefix and many
+/// different letters can precede the suffix, as after "walk" in "walking".
+class BoundaryStatistics {
+ public:
+  /// C'tor that computes the statistics in time linear in the total length
+  /// of the word types, plus the two sorts.
+  /// @param words The training words. Each type counts once, whatever its
+  ///     frequency.
+  /// @param min_types Prefixes and suffixes shared by fewer word types than
+  ///     this add nothing to the score, since their entropy is mostly noise.
+  BoundaryStatistics(const Corpus& words, size_t min_types);
+
+  /// Returns the boundary score between letters position - 1 and position
+  /// of the given word: the entropy after its prefix plus the entropy
+  /// before its suffix, in nats.
+  /// @param word Index of the word in the corpus.
+  /// @param position Boundary position, in [1, length of the word).
+  float score(size_t word, size_t position) const noexcept {
+    return scores_[offsets_[word] + position];
+  }
+
+ private:
+  /// Adds the entropies of one direction to the scores. The order lists the
+  /// word indices sorted by their letters read in that direction.
+  template <class LetterAt>
+  void Accumulate(const Corpus& words, const std::vector<size_t>& order,
+      LetterAt letter_at, bool reversed);
+
+  size_t min_types_;
+  std::vector<size_t> offsets_;
+  std::vector<float> scores_;
+};
+
+} // namespace morfessor
+
+#endif /* INCLUDE_BOUNDARY_STATISTICS_H_ */
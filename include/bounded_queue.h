@@ -0,0 +1,105 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef INCLUDE_BOUNDED_QUEUE_H_
+#define INCLUDE_BOUNDED_QUEUE_H_
+
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+namespace morfessor {
+
+/// A first-in first-out queue for handing work from one thread to another.
+/// Push blocks while the queue is full, so a fast producer cannot run ahead
+/// of a slow consumer by more than the capacity.
+template <class T>
+class BoundedQueue {
+ public:
+  /// @param capacity The most items the queue holds before Push blocks.
+  explicit BoundedQueue(size_t capacity);
+
+  /// Adds an item, waiting for room if the queue is full. Must not be
+  /// called after Close.
+  void Push(T item);
+
+  /// Removes the oldest item, waiting for one if the queue is empty.
+  /// @return False if the queue is closed and empty; item is then unchanged.
+  bool Pop(T* item);
+
+  /// Tells consumers that no more items will be pushed.
+  void Close();
+
+ private:
+  size_t capacity_;
+  bool closed_ = false;
+  std::deque<T> items_;
+  std::mutex mutex_;
+  std::condition_variable not_full_;
+  std::condition_variable not_empty_;
+};
+
+template <class T>
+BoundedQueue<T>::BoundedQueue(size_t capacity)
+    : capacity_{capacity}, items_{}, mutex_{}, not_full_{}, not_empty_{} {
+  assert(capacity > 0);
+}
+
+template <class T>
+void BoundedQueue<T>::Push(T item) {
+  std::unique_lock<std::mutex> lock{mutex_};
+  assert(!closed_);
+  not_full_.wait(lock, [this] { return items_.size() < capacity_; });
+  items_.push_back(std::move(item));
+  lock.unlock();
+  not_empty_.notify_one();
+}
+
+template <class T>
+bool BoundedQueue<T>::Pop(T* item) {
+  std::unique_lock<std::mutex> lock{mutex_};
+  not_empty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+  if (items_.empty()) {
+    return false;
+  }
+  *item = std::move(items_.front());
+  items_.pop_front();
+  lock.unlock();
+  not_full_.notify_one();
+  return true;
+}
+
+template <class T>
+void BoundedQueue<T>::Close() {
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    closed_ = true;
+  }
+  not_empty_.notify_all();
+}
+
+} // namespace morfessor
+
+#endif /* INCLUDE_BOUNDED_QUEUE_H_ */
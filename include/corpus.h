@@ -23,10 +23,12 @@
 #ifndef INCLUDE_CORPUS_H_
 #define INCLUDE_CORPUS_H_
 
+#include <functional>
 #include <string>
 #include <vector>
 #include <istream>
 
+#include "line_scanner.h"
 #include "morph.h"
 
 namespace morfessor
@@ -38,7 +40,36 @@ class Corpus
   using iterator = std::vector<Morph>::iterator;
   using const_iterator = std::vector<Morph>::const_iterator;
   explicit Corpus(std::istream& in);
+
+  /// C'tor that reads a word list, or a model written by
+  /// Segmentation::print_front_coded, which starts with kFrontCodedMagic.
   explicit Corpus(std::string word_file);
+  explicit Corpus(std::vector<Morph> words);
+
+  /// The first bytes of a front coded model file.
+  static constexpr char kFrontCodedMagic[] = "MFC1";
+
+  /// Parses one line of a word list: a count followed by a word.
+  static Morph ParseLine(const std::string& line);
+
+  /// Parses the lines of a word list at the start of text like ParseLine,
+  /// but finds the line ends and blanks with ScanBlocks and reads counts
+  /// with ParseCount. Lines of another shape, such as the cost line of a
+  /// model, go through ParseLine.
+  /// @param at_end True if text ends the word list, so that a last line
+  ///     without a newline is complete.
+  /// @param words Receives a Morph for every complete line.
+  /// @return The number of bytes parsed, which is where the first line
+  ///     that may not be complete starts.
+  static size_t ParseLines(const char* text, size_t size, bool at_end,
+      std::vector<Morph>* words, ScanLevel level = SupportedScanLevel());
+
+  /// Reads a word list from a stream a chunk at a time with ParseLines,
+  /// carrying a line cut off at the end of a chunk over to the next.
+  /// @param parsed Called with the words of each chunk, which it may take.
+  static void ParseStream(std::istream& in,
+      const std::function<void(std::vector<Morph>* words)>& parsed);
+
   size_t size() const noexcept { return words_.size(); }
   iterator begin() noexcept { return words_.begin(); }
   iterator end() noexcept { return words_.end(); }
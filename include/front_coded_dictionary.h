@@ -0,0 +1,99 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef INCLUDE_FRONT_CODED_DICTIONARY_H_
+#define INCLUDE_FRONT_CODED_DICTIONARY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "morph.h"
+
+namespace morfessor {
+
+/// A sorted, read-only set of strings with a count for each, compressed by
+/// front coding. The strings are cut into blocks of kBlockSize. The first
+/// string of a block is kept whole, and each of the others as the length of
+/// the prefix it shares with the string before it and the rest of its
+/// letters. Lengths and counts are varints. A lookup binary searches the
+/// first strings of the blocks, which can be compared in place, and then
+/// decodes a single block, so nothing else is decompressed.
+class FrontCodedDictionary {
+ public:
+  /// The number of strings in a block.
+  static constexpr size_t kBlockSize = 16;
+
+  /// C'tor for a dictionary of the given strings and counts. The strings
+  /// are sorted here and must be distinct.
+  explicit FrontCodedDictionary(std::vector<Morph> entries);
+
+  /// C'tor that reads a dictionary written by Write. If the data is cut
+  /// off or does not decode, the dictionary is left empty and the stream is
+  /// put in the failed state.
+  explicit FrontCodedDictionary(std::istream& in);
+
+  /// Writes the dictionary in binary form.
+  void Write(std::ostream& out) const;
+
+  /// Looks a string up.
+  /// @param count Receives the count of the string if it was found.
+  /// @return True if the string is in the dictionary.
+  bool Find(const std::string& letters, size_t* count) const;
+
+  /// Calls visit with every string and its count, in sorted order, decoding
+  /// one block at a time.
+  void ForEach(const std::function<void(const std::string&, size_t)>& visit)
+      const;
+
+  /// Returns the number of strings.
+  size_t size() const noexcept { return size_; }
+
+  /// Returns the size of the compressed strings and counts, in bytes.
+  size_t bytes() const noexcept { return data_.size(); }
+
+ private:
+  /// Returns true if every block decodes within data_ and the blocks end
+  /// where data_ does.
+  bool Check() const;
+
+  /// Decodes the entries of a block, up to and including the one for which
+  /// visit returns false.
+  void DecodeBlock(size_t block,
+      const std::function<bool(const std::string&, size_t)>& visit) const;
+
+  /// The blocks, end to end.
+  std::string data_;
+
+  /// Where each block starts in data_.
+  std::vector<uint32_t> block_offsets_;
+
+  size_t size_ = 0;
+};
+
+}  // namespace morfessor
+
+#endif /* INCLUDE_FRONT_CODED_DICTIONARY_H_ */
@@ -0,0 +1,110 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef INCLUDE_LEXICON_DIFF_H_
+#define INCLUDE_LEXICON_DIFF_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#include "corpus.h"
+
+namespace morfessor {
+
+/// The differences between the morph counts of two lexicons, such as the
+/// models written by two training runs.
+class LexiconDiff {
+ public:
+  /// Old and new morph counts, where a count of 0 means the morph is absent.
+  using CountChange = std::pair<size_t, size_t>;
+
+  /// C'tor that compares two lexicons given as lists of morphs and counts.
+  /// @param old_lexicon The lexicon before the change.
+  /// @param new_lexicon The lexicon after the change.
+  LexiconDiff(const Corpus& old_lexicon, const Corpus& new_lexicon);
+
+  /// Returns the morphs whose count changed, including added and removed
+  /// morphs, mapped to their old and new counts.
+  const std::unordered_map<std::string, CountChange>& changes() const noexcept;
+
+  /// Returns true if the count of the morph changed.
+  bool changed(const std::string& morph) const;
+
+  /// Returns true if the morph was added or its count went up, which can
+  /// make a split that uses it cheaper than before.
+  bool gained(const std::string& morph) const;
+
+  /// Returns the morphs that are in both lexicons with the same count,
+  /// mapped to that count. Their costs still move when the total number of
+  /// morph tokens changes.
+  const std::unordered_map<std::string, size_t>& unchanged() const noexcept {
+    return unchanged_;
+  }
+
+  /// Returns the length of the longest gained morph, or 0 if there is none.
+  size_t max_gained_length() const noexcept { return max_gained_length_; }
+
+  /// Returns the total number of morph tokens in the old lexicon.
+  size_t old_total() const noexcept { return old_total_; }
+
+  /// Returns the total number of morph tokens in the new lexicon.
+  size_t new_total() const noexcept { return new_total_; }
+
+ private:
+  std::unordered_map<std::string, CountChange> changes_;
+  std::unordered_map<std::string, size_t> unchanged_;
+  std::unordered_set<std::string> gained_;
+  size_t max_gained_length_ = 0;
+  size_t old_total_ = 0;
+  size_t new_total_ = 0;
+};
+
+/// Returns a checksum of the morphs and counts of a lexicon, such as a
+/// model file, that does not depend on the order they are listed in.
+/// Entries with an empty morph, like the cost line of a model file, are
+/// skipped.
+uint64_t LexiconChecksum(const Corpus& lexicon);
+
+/// Returns what one morph and its count add to LexiconChecksum. The
+/// checksum is the sum of these, so it can be updated one morph at a time.
+uint64_t LexiconEntryHash(const std::string& morph, size_t count);
+
+inline const std::unordered_map<std::string, LexiconDiff::CountChange>&
+LexiconDiff::changes() const noexcept {
+  return changes_;
+}
+
+inline bool LexiconDiff::changed(const std::string& morph) const {
+  return changes_.find(morph) != changes_.end();
+}
+
+inline bool LexiconDiff::gained(const std::string& morph) const {
+  return gained_.find(morph) != gained_.end();
+}
+
+} // namespace morfessor
+
+#endif /* INCLUDE_LEXICON_DIFF_H_ */
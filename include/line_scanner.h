@@ -0,0 +1,54 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef INCLUDE_LINE_SCANNER_H_
+#define INCLUDE_LINE_SCANNER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace morfessor {
+
+/// The instructions ScanBlocks uses.
+enum class ScanLevel { kScalar, kSse2, kAvx2 };
+
+/// Returns the widest ScanLevel this CPU runs, which is checked once.
+ScanLevel SupportedScanLevel() noexcept;
+
+/// Finds the newlines and the blanks of a word list 64 bytes at a time.
+/// Bit i of newlines[b] is set if text[64 * b + i] is '\n', and bit i of
+/// blanks[b] if it is a space, tab, carriage return, vertical tab or form
+/// feed, which with the newline are the bytes that stream extraction skips.
+/// @param blocks The number of 64 byte blocks, all of which must be
+///     readable.
+void ScanBlocks(const char* text, size_t blocks, uint64_t* newlines,
+    uint64_t* blanks, ScanLevel level = SupportedScanLevel()) noexcept;
+
+/// Parses a count of 1 to 19 decimal digits without a branch per digit.
+/// @param text The digits, of which 8 bytes from text onwards must be
+///     readable when length is at most 8.
+/// @return False if a byte is not a digit or length is out of range.
+bool ParseCount(const char* text, size_t length, size_t* count) noexcept;
+
+} // namespace morfessor
+
+#endif /* INCLUDE_LINE_SCANNER_H_ */
@@ -0,0 +1,133 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef INCLUDE_METRICS_H_
+#define INCLUDE_METRICS_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace morfessor {
+
+/// Counters, gauges and histograms that can be written in the Prometheus
+/// text exposition format. All methods may be called from any thread.
+class Metrics {
+ public:
+  /// Declares a counter, which only goes up.
+  void DefineCounter(const std::string& name, const std::string& help);
+
+  /// Label names and values, in the order they are written.
+  using Labels = std::vector<std::pair<std::string, std::string>>;
+
+  /// Declares a gauge, which is set to the current value of something.
+  /// @param labels Written between braces after the name, such as
+  ///     path="model.txt". Backslashes, double quotes and newlines in the
+  ///     values are escaped.
+  void DefineGauge(const std::string& name, const std::string& help,
+      Labels labels = {});
+
+  /// Declares a histogram with the given upper bucket bounds, in
+  /// increasing order. A +Inf bucket is added.
+  void DefineHistogram(const std::string& name, const std::string& help,
+      std::vector<double> bounds);
+
+  /// Adds to a counter.
+  void Add(const std::string& name, double delta);
+
+  /// Sets a gauge.
+  void Set(const std::string& name, double value);
+
+  /// Records one observation in a histogram.
+  void Observe(const std::string& name, double value);
+
+  /// Writes every metric, in the order they were defined.
+  void Write(std::ostream& out) const;
+
+ private:
+  struct Metric {
+    Metric(std::string name, std::string help, std::string type,
+        Labels labels = {})
+        : name{std::move(name)}, help{std::move(help)}, type{std::move(type)},
+          labels{std::move(labels)} {}
+
+    std::string name;
+    std::string help;
+    std::string type;
+    Labels labels;
+    double value = 0;
+    std::vector<double> bounds;
+    std::vector<size_t> bucket_counts;
+    size_t count = 0;
+  };
+
+  Metric& Find(const std::string& name);
+
+  mutable std::mutex mutex_;
+  std::vector<Metric> metrics_;
+  std::map<std::string, size_t> index_;
+};
+
+/// Rewrites a file with the metrics at a fixed interval, from its own
+/// thread, so that a scraper such as the node exporter's textfile collector
+/// can pick them up. Each write goes to a temporary file that is renamed
+/// over the old one, so readers never see half a file. The file is written
+/// once more when the writer is destroyed.
+class MetricsFile {
+ public:
+  /// @param update Called before each write, to refresh gauges.
+  MetricsFile(std::string path, Metrics* metrics,
+      std::chrono::milliseconds interval,
+      std::function<void(Metrics*)> update);
+  ~MetricsFile();
+
+  MetricsFile(const MetricsFile&) = delete;
+  MetricsFile& operator=(const MetricsFile&) = delete;
+
+ private:
+  void WriteOnce();
+
+  std::string path_;
+  Metrics* metrics_;
+  std::chrono::milliseconds interval_;
+  std::function<void(Metrics*)> update_;
+  bool stopping_ = false;
+  std::mutex mutex_;
+  std::condition_variable stop_;
+  std::thread thread_;
+};
+
+/// Sets the process memory gauges, process_resident_memory_bytes and
+/// morfessor_peak_resident_memory_bytes, defining them if needed.
+void UpdateMemoryMetrics(Metrics* metrics);
+
+} // namespace morfessor
+
+#endif /* INCLUDE_METRICS_H_ */
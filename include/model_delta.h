@@ -0,0 +1,101 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef INCLUDE_MODEL_DELTA_H_
+#define INCLUDE_MODEL_DELTA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "corpus.h"
+#include "morph.h"
+#include "viterbi_lexicon.h"
+
+namespace morfessor {
+
+/// The changes that turn one model into another, so that a new model can
+/// be shipped as the morphs whose counts changed instead of as a whole.
+/// The checksums of both models come with it, so that a delta is only
+/// applied to the model it was made from, and the result is checked.
+///
+/// The text format has a header line followed by one line per changed
+/// morph, in sorted order:
+///
+///     Model delta: <old total> <new total> <old checksum> <new checksum>
+///     <old count> <new count> <morph>
+///
+/// where a count of 0 means the morph is absent and the checksums are
+/// those of LexiconChecksum, in hex.
+class ModelDelta {
+ public:
+  /// The count of a morph before and after.
+  struct Change {
+    std::string morph;
+    size_t old_count;
+    size_t new_count;
+  };
+
+  /// C'tor for the delta from one model to another.
+  ModelDelta(const Corpus& old_model, const Corpus& new_model);
+
+  /// C'tor that reads a delta written by Write.
+  explicit ModelDelta(std::istream& in);
+
+  /// Writes the delta in the text format.
+  void Write(std::ostream& out) const;
+
+  /// Makes the morphs and counts of the new model from the old one.
+  /// @param new_model Receives the new model.
+  /// @return False if old_model is not the model the delta was made from,
+  ///     or the result does not have the new checksum.
+  bool Apply(const Corpus& old_model, std::vector<Morph>* new_model) const;
+
+  /// Changes a frozen lexicon of the old model into one of the new model
+  /// in place, including the cost of every morph.
+  /// @return False if the lexicon is not that of the old model, in which
+  ///     case it is left alone, or if the result does not have the new
+  ///     checksum.
+  bool Apply(ViterbiLexicon* lexicon) const;
+
+  /// Returns the changed morphs, in sorted order.
+  const std::vector<Change>& changes() const noexcept { return changes_; }
+
+  size_t old_total() const noexcept { return old_total_; }
+  size_t new_total() const noexcept { return new_total_; }
+  uint64_t old_checksum() const noexcept { return old_checksum_; }
+  uint64_t new_checksum() const noexcept { return new_checksum_; }
+
+ private:
+  std::vector<Change> changes_;
+  size_t old_total_ = 0;
+  size_t new_total_ = 0;
+  uint64_t old_checksum_ = 0;
+  uint64_t new_checksum_ = 0;
+};
+
+} // namespace morfessor
+
+#endif /* INCLUDE_MODEL_DELTA_H_ */
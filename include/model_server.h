@@ -0,0 +1,130 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef INCLUDE_MODEL_SERVER_H_
+#define INCLUDE_MODEL_SERVER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "segmentation.h"
+#include "shared_ring.h"
+
+namespace morfessor {
+
+/// What one served model takes and has done.
+struct ServedModelStats {
+  /// Morphs in the frozen lexicon.
+  size_t morphs = 0;
+  /// Bytes of the frozen lexicon.
+  size_t lexicon_bytes = 0;
+  /// How much the resident set grew while the model was loaded, which
+  /// includes the split tree kept next to the frozen lexicon.
+  size_t resident_bytes = 0;
+  /// Words segmented with the model.
+  size_t words = 0;
+  /// Thread time spent segmenting them, in seconds.
+  double segment_seconds = 0;
+};
+
+/// Segments words with several loaded models in one process, such as one
+/// per language. Each request names its model. One pool of threads
+/// segments the words of every model, and the lines are written in the
+/// order the requests came in.
+class ModelServer {
+ public:
+  /// @param threads The number of threads that segment words.
+  explicit ModelServer(size_t threads);
+
+  /// Adds a model to serve. The segmentation should be frozen.
+  /// @param name The name requests use for the model.
+  /// @param segmentation The loaded model.
+  /// @param resident_bytes What loading the model added to the resident
+  ///     set, for stats.
+  void AddModel(const std::string& name,
+      std::unique_ptr<Segmentation> segmentation, size_t resident_bytes);
+
+  /// Answers requests until the input ends. A request is a line with a
+  /// model name, a tab and a word; a line without a tab is a word for the
+  /// first model added. The answer is the line that --load writes for the
+  /// word, or an empty line if no model has that name. The answers are
+  /// flushed batch by batch, and a batch ends wherever the input has no
+  /// more lines buffered, so a client can wait for each answer.
+  void Serve(std::istream& in, std::ostream& out);
+
+  /// Answers the words a client puts in a shared ring until it closes the
+  /// ring. The ring should have been created with the names of the models
+  /// in the order they were added. A word for an unknown model, or one
+  /// whose length does not fit in a slot, is answered with no morphs. This
+  /// runs on the calling thread rather than on the pool, so that an answer
+  /// does not wait for a thread to be scheduled.
+  void ServeRing(SharedRing* ring);
+
+  /// Returns the names of the models, in the order they were added.
+  std::vector<std::string> names() const;
+
+  /// Returns the stats of a model, by name.
+  ServedModelStats stats(const std::string& name) const;
+
+  /// Returns the number of requests that named no model.
+  size_t unknown_requests() const noexcept { return unknown_requests_; }
+
+  /// Returns the number of ring requests whose word length did not fit in
+  /// a slot.
+  size_t malformed_requests() const noexcept { return malformed_requests_; }
+
+ private:
+  struct Served {
+    std::string name;
+    std::unique_ptr<Segmentation> segmentation;
+    size_t resident_bytes;
+    std::atomic<size_t> words{0};
+    std::atomic<int64_t> segment_nanoseconds{0};
+  };
+
+  /// Segments a batch of requests in place, one model at a time.
+  void Answer(std::vector<std::string>* lines);
+
+  /// Segments the words of a model and counts them and the time taken.
+  void Segment(Served* served, std::vector<std::string>* words);
+
+  /// Splits the words of a model into morph lengths, and counts them and
+  /// the time taken.
+  void Split(Served* served, const std::vector<std::string>& words,
+      std::vector<std::vector<size_t>>* morph_lengths);
+
+  size_t threads_;
+  std::vector<std::unique_ptr<Served>> models_;
+  std::unordered_map<std::string, size_t> index_;
+  std::atomic<size_t> unknown_requests_{0};
+  std::atomic<size_t> malformed_requests_{0};
+};
+
+} // namespace morfessor
+
+#endif /* INCLUDE_MODEL_SERVER_H_ */
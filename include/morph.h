@@ -34,7 +34,7 @@ class Morph
 {
  public:
   Morph(std::string letters, size_t frequency);
-  std::string letters() const noexcept { return letters_; }
+  const std::string& letters() const noexcept { return letters_; }
   size_t frequency() const noexcept { return frequency_; }
   size_t length() const noexcept { return letters_.length(); }
  private:
@@ -55,6 +55,10 @@ struct MorphNode {
 	/// Key for the right child in the data structure. Equal to the empty
 	/// string if there is no right child.
 	std::string right_child;
+
+	/// When the node was last used while optimizing, as counted by the
+	/// segmentation. Used to pick nodes to spill to disk.
+	size_t last_touched;
 };
 
 inline bool MorphNode::has_children() const noexcept {
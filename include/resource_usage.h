@@ -0,0 +1,45 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef INCLUDE_RESOURCE_USAGE_H_
+#define INCLUDE_RESOURCE_USAGE_H_
+
+#include <cstddef>
+
+namespace morfessor {
+
+/// Returns the largest resident set size the process has had so far, in
+/// bytes. Returns 0 if the operating system does not report it.
+size_t PeakResidentBytes();
+
+/// Returns the current resident set size of the process, in bytes. Returns
+/// 0 if the operating system does not report it.
+size_t CurrentResidentBytes();
+
+/// Asks the allocator to give the memory it holds but no longer uses back
+/// to the operating system, so that CurrentResidentBytes counts only what
+/// is in use. Does nothing where the allocator cannot do that.
+void ReleaseFreeMemory();
+
+} // namespace morfessor
+
+#endif /* INCLUDE_RESOURCE_USAGE_H_ */
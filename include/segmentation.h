@@ -23,21 +23,44 @@
 #ifndef INCLUDE_SEGMENTATION_H_
 #define INCLUDE_SEGMENTATION_H_
 
+#include <atomic>
 #include <cmath>
 #include <cassert>
+#include <csignal>
 #include <unordered_map>
+#include <functional>
 #include <iosfwd>
 #include <memory>
+#include <utility>
 #include <vector>
 #include <string>
 
+#include "boundary_statistics.h"
 #include "morph.h"
 #include "model.h"
 #include "types.h"
+#include "model_delta.h"
 #include "morph_node.h"
+#include "segmentation_cache.h"
+#include "spill_file.h"
+#include "viterbi_lexicon.h"
 
 namespace morfessor {
 
+/// Where Optimize is, for reporting progress while it runs.
+struct OptimizeProgress {
+  /// The current epoch, counting from 1.
+  size_t epoch;
+  /// Words resplit so far in this epoch.
+  size_t position;
+  /// Words resplit per epoch.
+  size_t words;
+  /// Seconds since the epoch started.
+  double epoch_seconds;
+  /// Seconds since Optimize started.
+  double total_seconds;
+};
+
 /// Stores recursive segmentations of a set of words.
 class Segmentation {
  public:
@@ -48,14 +71,214 @@ class Segmentation {
   explicit Segmentation(const Corpus& training_corpus,
       std::shared_ptr<Model> model);
 
+  /// C'tor that limits the number of nodes in memory from the start.
+  /// @see EnableSpilling
+  Segmentation(const Corpus& training_corpus, std::shared_ptr<Model> model,
+      std::string spill_path, size_t max_resident_nodes);
+
   /// Returns the best splits for a test corpus given the current segmentation.
   std::shared_ptr<std::vector<std::string> >
   SegmentTestCorpus(const Corpus& test_corpus);
 
+  /// Returns the best splits for a test corpus, reusing the splits of words
+  /// that are in the cache and not stale.
+  std::shared_ptr<std::vector<std::string> >
+  SegmentTestCorpus(const Corpus& test_corpus,
+      const SegmentationCache& cache);
+
+  /// Returns the best split of a single word as its morphs, each followed
+  /// by a space, the same as an entry of SegmentTestCorpus.
+  std::string SegmentWord(const std::string& word) const;
+
+  /// Replaces every word with its best split, in the format of SegmentWord.
+  /// Words of the same length are split together, kViterbiLanes at a time,
+  /// in alphabetical order so that the work for a prefix shared with the
+  /// previous word is not repeated. The result is the same as splitting
+  /// the words one by one.
+  void SegmentBatch(std::vector<std::string>* words) const;
+
+  /// Finds the best split of every word like SegmentBatch, but returns the
+  /// lengths of the morphs, as ViterbiSplit does, instead of the text. An
+  /// empty word has no morphs.
+  void SplitBatch(const std::vector<std::string>& words,
+      std::vector<std::vector<size_t>>* morph_lengths) const;
+
+  /// Makes a compact read-only copy of the lexicon, including spilled
+  /// nodes, for SegmentBatch, SegmentTestCorpus and SegmentText to look
+  /// morphs up in. Call it once training is over; any later change to the
+  /// segmentation drops the copy.
+  /// @param hot_morphs How many of the most frequent morphs to keep in the
+  ///     small array that stays in cache. Hot and cold morphs are found
+  ///     through the same table; the tiers only differ in where the entry
+  ///     lives.
+  /// @param steps_per_nat The resolution of the 16 bit costs of the copy.
+  ///     One step per nat keeps the whole numbers of ViterbiSplit, and so
+  ///     its splits; more steps keep more of the fraction it drops, which
+  ///     changes some splits.
+  void Freeze(size_t hot_morphs = 0, unsigned steps_per_nat = 1);
+
+  /// Drops the morphs and splits the frozen lexicon was made from, for a
+  /// segmentation that is only used to segment from then on. Call it after
+  /// Freeze. Afterwards only SegmentBatch, SplitBatch and SegmentText may
+  /// be called, since everything else reads the nodes.
+  void ReleaseNodes();
+
+  /// Changes the counts of the morphs of a loaded model to those of a newer
+  /// one, as given by a delta, without reading the newer model. A frozen
+  /// copy of the lexicon is patched in place rather than dropped.
+  /// @param delta The changes from the model this was loaded from.
+  /// @return False, without changing anything, if the leaves are not those
+  ///     of the model the delta was made from; or false if the result does
+  ///     not have the checksum of the newer model.
+  bool ApplyDelta(const ModelDelta& delta);
+
+  /// Makes SegmentBatch look up the substrings of the words it splits in
+  /// lockstep with ViterbiLexicon::FindBatch, which is the default, or one
+  /// at a time. Only the speed differs.
+  void set_batch_probes(bool batch) noexcept;
+
+  /// Returns how many lookups in the frozen lexicon each tier answered,
+  /// over every call to SegmentBatch and SegmentTestCorpus so far.
+  LexiconTierStats lexicon_stats() const noexcept;
+
+  /// Returns the number of morphs in the frozen lexicon, or 0 if there is
+  /// none.
+  size_t frozen_size() const noexcept;
+
+  /// Returns the bytes taken by the frozen lexicon, or 0 if there is none.
+  size_t frozen_bytes() const noexcept;
+
+  /// The number of words of the same length that SegmentBatch splits in
+  /// lockstep.
+  static constexpr size_t kViterbiLanes = 8;
+
+  /// The longest word that SegmentBatch splits in lockstep without a
+  /// frozen lexicon; longer ones go through ViterbiSplit.
+  static constexpr size_t kLongestUnfrozenLaneWord = 64;
+
+  /// The number of words of running text that SegmentText splits at once.
+  static constexpr size_t kTextBatchWords = 4096;
+
+  /// Finds the best split of a single word given the current segmentation,
+  /// using the Viterbi algorithm.
+  /// @param word The word to split. Cannot be empty string.
+  /// @return The lengths of the morphs in the split, from left to right.
+  std::vector<size_t> ViterbiSplit(const std::string& word) const;
+
+  /// Returns the code length in nats of a held-out word list under the
+  /// current lexicon: for every word, its count times the cost of its
+  /// cheapest split into leaf morphs, each morph costing the log of its
+  /// share of the morph tokens and an unknown letter costing what it costs
+  /// in ViterbiSplit. Unlike ViterbiSplit the costs keep their fractions,
+  /// and only leaves are used, so a model scores the same before and after
+  /// it is written and loaded again. No split is kept. Spilled nodes are
+  /// not seen.
+  /// @param threads The threads to score on. The result does not depend on
+  ///     their number.
+  double Score(const Corpus& heldout, size_t threads = 1) const;
+
+  /// Makes Optimize score a held-out word list after every epoch, and stop
+  /// once the score has not improved for the given number of epochs, even
+  /// if the training cost is still falling. The segmentation is left as it
+  /// is after the last epoch, not rolled back to the best one. Cannot be
+  /// combined with spilling.
+  /// @param heldout The word list to score; it must outlive the calls to
+  ///     Optimize. Null stops the scoring.
+  /// @param patience Epochs without improvement to allow, or 0 to only
+  ///     record the scores.
+  /// @param threads The threads to score on.
+  void set_heldout(const Corpus* heldout, size_t patience, size_t threads);
+
+  /// Returns the held-out score after each epoch of the last call to
+  /// Optimize, or nothing if no held-out word list was set.
+  const std::vector<double>& heldout_costs() const noexcept;
+
+  /// Copies running text from in to out, inserting a separator at the morph
+  /// boundaries of every word. Punctuation and whitespace are copied
+  /// unchanged. Words are looked up in lower case, but written as they
+  /// appear in the text. The input is processed in one streaming pass, and
+  /// every kTextBatchWords words are split together with SplitBatch, so a
+  /// frozen lexicon is used if there is one.
+  /// @param separator The string to insert between two morphs.
+  std::ostream& SegmentText(std::istream& in, std::ostream& out,
+      const std::string& separator) const;
+
   /// Updates the data structure by recursively finding the best split
   /// for each morph.
   void Optimize();
 
+  /// Makes Optimize call report before resplitting a word whenever
+  /// *request is nonzero, and then clear *request. The request is meant to
+  /// be set by a signal handler; checking it costs one load per word, and
+  /// nothing at all if request is null.
+  void set_progress_request(volatile std::sig_atomic_t* request,
+      std::function<void(const OptimizeProgress&)> report);
+
+  /// Makes Optimize shuffle the words with a generator seeded with the
+  /// given value, so that runs can be repeated. Unless this is called, the
+  /// seed comes from std::random_device.
+  void set_seed(unsigned seed) noexcept;
+
+  /// Makes Optimize resplit the words in batches on the given number of
+  /// threads. Every word of a batch is resplit against the segmentation as
+  /// it was when the batch started, and the chosen splits are then applied
+  /// in shuffled order, so for a given seed and batch size the result is
+  /// the same whatever the number of threads. Zero threads switches back to
+  /// resplitting one word at a time. Cannot be combined with spilling.
+  /// @param batch_words The number of words resplit against one snapshot.
+  void set_threads(size_t threads, size_t batch_words);
+
+  /// Updates the data structure by recursively finding the best split for
+  /// each word of the training corpus. Use this after SeedSplits, which
+  /// adds nodes that are not words.
+  void Optimize(const Corpus& training_corpus);
+
+  /// Splits the training words where the boundary statistics are above the
+  /// threshold, strongest boundary first and recursively within each part,
+  /// so that Optimize starts near a good segmentation instead of from
+  /// unsplit words. Call before Optimize, with the corpus the segmentation
+  /// was constructed with.
+  /// @param statistics Boundary statistics of the training corpus.
+  /// @param threshold The lowest score at which a word is split.
+  /// @return The number of words that were split.
+  size_t SeedSplits(const Corpus& training_corpus,
+      const BoundaryStatistics& statistics, double threshold);
+
+  /// Removes words from the segmentation and their cost from the model,
+  /// for example to leave rare words out of training. The letter
+  /// probabilities of the model are not changed.
+  void RemoveWords(const Corpus& words);
+
+  /// Adds words with the splits that ViterbiSplit finds for them among the
+  /// current morphs, and updates the model to match. Every split is found
+  /// before any word is added, so the words do not affect each other. A
+  /// word that is already a morph keeps its split and gains the count.
+  /// Spilled nodes are read back first.
+  /// @return The number of words added.
+  size_t AddViterbiSplits(const Corpus& words);
+
+  /// Limits the number of nodes kept in memory while optimizing. When there
+  /// are more, the nodes with the lowest counts that were used least
+  /// recently are written to a spill file, and read back when they are
+  /// needed again. The print functions include spilled nodes, but other
+  /// lookups such as contains, at and the Viterbi search only see nodes in
+  /// memory until Unspill is called.
+  /// @param path The spill file to create.
+  /// @param max_resident_nodes The most nodes to keep in memory.
+  void EnableSpilling(std::string path, size_t max_resident_nodes);
+
+  /// Reads all spilled nodes back into memory.
+  void Unspill();
+
+  /// Returns the I/O counters of the spill file, or nullptr if spilling is
+  /// not enabled.
+  const SpillStats* spill_stats() const noexcept;
+
+  /// Returns the wall time in seconds taken by each pass over the words
+  /// during the last call to Optimize. The number of entries is the number
+  /// of epochs it took to converge.
+  const std::vector<double>& epoch_seconds() const noexcept;
+
   /// Recursively finds the best split for a morph or word. Whereas regular
   /// Split will only split a morph once, and only where you tell it
   /// to, this will find the best way to split the morph, and it will
@@ -89,6 +312,12 @@ class Segmentation {
   /// @param out An output stream.
   std::ostream& print(std::ostream& out) const;
 
+  /// Writes the morphs and counts that print writes, in binary: the
+  /// Corpus::kFrontCodedMagic bytes, the overall cost as a double, and a
+  /// FrontCodedDictionary. Corpus reads the file back like a text model.
+  /// @param out An output stream.
+  std::ostream& print_front_coded(std::ostream& out) const;
+
   /// Prints the current state of the model, in the expected format for a
   // corpus.
   /// @param out An output stream.
@@ -102,17 +331,201 @@ class Segmentation {
   std::ostream& print_dot_debug() const;
 
  private:
+  using NodeMap = std::unordered_map<std::string, MorphNode>;
+
+  /// Adds every word of the training corpus as its own morph.
+  void AddWords(const Corpus& training_corpus);
+
+  /// Resplits each word in keys until the cost stops improving.
+  void Optimize(std::vector<std::string> keys);
+
+  /// The tables of ViterbiSplitLanes for one word length, kept from one
+  /// call to the next.
+  struct ViterbiLaneState;
+
+  /// Runs ViterbiSplit for up to kViterbiLanes words of the same nonzero
+  /// length at once. The cost of every substring is gathered first, lane
+  /// by lane, and the recurrences then run across the lanes so that the
+  /// compiler can keep the words in vector registers. The first i columns
+  /// depend only on the first i letters, so the columns for the prefix a
+  /// word shares with the previous word of its lane are kept.
+  /// @param words One word per lane, or null for an idle lane.
+  /// @param morph_lengths Receives the split of each word.
+  void ViterbiSplitLanes(ViterbiLaneState* state,
+      const std::string* const* words,
+      std::vector<size_t>* morph_lengths) const;
+
+  /// The threads and trials that ResplitBatch resplits words with.
+  class ResplitWorkers;
+
+  /// Resplits keys[begin, end) in parallel against the current
+  /// segmentation, then applies the chosen splits in order.
+  void ResplitBatch(ResplitWorkers* workers,
+      const std::vector<std::string>& keys, size_t begin, size_t end);
+
+  /// Replays the choices a ResplitNode on another state made for morph and,
+  /// recursively, its parts. The split positions are consumed from *next.
+  void ApplyResplit(const std::string& morph,
+      const std::vector<size_t>& split_indices, size_t* next);
+
+  /// Adds count to a morph that is split into parts of the given lengths,
+  /// as a chain of binary splits from the left. A morph that already
+  /// exists keeps its own split.
+  void AddSplit(const std::string& morph, size_t count,
+      const size_t* lengths, size_t parts);
+
+  /// Seeds the split of word[start, end), the word with the given index in
+  /// the training corpus. Returns true if the span ends up split.
+  bool SeedSpan(const std::string& word, size_t index, size_t start,
+      size_t end, const BoundaryStatistics& statistics, double threshold);
+
+  /// Returns the node for a morph, reading it back from the spill file if
+  /// needed, or nodes_.end() if there is no such node.
+  NodeMap::iterator Restore(const std::string& morph);
+
   /// The data structure containing the morphs and their splits.
-  std::unordered_map<std::string, MorphNode> nodes_;
+  NodeMap nodes_;
 
   /// The probabilistic model that guides the segmentation.
   std::shared_ptr<Model> model_;
+
+  /// Calls a function for every node, in memory or spilled.
+  void ForEachNode(const std::function<void(const std::string&,
+      const MorphNode&)>& visit) const;
+
+  /// Returns the node for a morph, reading it back from the spill file or
+  /// creating it if it is not in memory, and marks it as recently used.
+  MorphNode& Touch(const std::string& morph);
+
+  /// Writes the coldest nodes to the spill file until at most the given
+  /// number of nodes is left in memory.
+  void SpillColdNodes(size_t target_resident_nodes);
+
+  /// Wall time of each epoch of the last optimization.
+  std::vector<double> epoch_seconds_;
+
+  /// Where nodes go when there are too many in memory. Null unless
+  /// spilling is enabled.
+  std::unique_ptr<SpillFile> spill_;
+
+  /// The most nodes to keep in memory when spilling is enabled.
+  size_t max_resident_nodes_ = 0;
+
+  /// Advances once per word resplit; nodes record it when they are used.
+  size_t touch_clock_ = 0;
+
+  /// Set to ask Optimize for a progress report, or null.
+  volatile std::sig_atomic_t* progress_request_ = nullptr;
+
+  /// Called with the progress of Optimize when it is requested.
+  std::function<void(const OptimizeProgress&)> report_progress_;
+
+  /// Seed for shuffling the words, used if has_seed_ is set.
+  unsigned seed_ = 0;
+  bool has_seed_ = false;
+
+  /// Read-only copy of the lexicon made by Freeze, or null.
+  std::unique_ptr<ViterbiLexicon> frozen_;
+
+  /// Set by ReleaseNodes, after which nodes_ is empty.
+  bool nodes_released_ = false;
+
+  /// Lookups in frozen_ by the tier that answered them, added up once per
+  /// word length of a batch.
+  mutable std::atomic<size_t> hot_hits_{0};
+  mutable std::atomic<size_t> cold_hits_{0};
+  mutable std::atomic<size_t> misses_{0};
+
+  /// Whether ViterbiSplitLanes uses ViterbiLexicon::FindBatch.
+  bool batch_probes_ = true;
+
+  /// Threads for batched resplitting, or zero to resplit serially.
+  size_t threads_ = 0;
+
+  /// Words resplit against one snapshot when threads_ is nonzero.
+  size_t batch_words_ = 0;
+
+  /// The choices of the last batch, by position in the batch, kept so that
+  /// their storage is reused.
+  std::vector<std::vector<size_t>> batch_splits_;
+
+  /// Word list scored after every epoch, or null.
+  const Corpus* heldout_ = nullptr;
+
+  /// Epochs without a better held-out score before Optimize stops, or 0.
+  size_t heldout_patience_ = 0;
+
+  /// Threads to score heldout_ on.
+  size_t score_threads_ = 1;
+
+  /// Held-out score after each epoch of the last optimization.
+  std::vector<double> heldout_costs_;
 };
 
+inline void Segmentation::set_progress_request(
+    volatile std::sig_atomic_t* request,
+    std::function<void(const OptimizeProgress&)> report) {
+  progress_request_ = request;
+  report_progress_ = std::move(report);
+}
+
+inline void Segmentation::set_seed(unsigned seed) noexcept {
+  seed_ = seed;
+  has_seed_ = true;
+}
+
+inline void Segmentation::set_threads(size_t threads, size_t batch_words) {
+  assert(threads == 0 || (batch_words > 0 && !spill_));
+  threads_ = threads;
+  batch_words_ = batch_words;
+}
+
+inline void Segmentation::set_heldout(const Corpus* heldout,
+    size_t patience, size_t threads) {
+  assert(heldout == nullptr || (threads > 0 && !spill_));
+  heldout_ = heldout;
+  heldout_patience_ = patience;
+  score_threads_ = threads;
+}
+
+inline const std::vector<double>& Segmentation::heldout_costs()
+    const noexcept {
+  return heldout_costs_;
+}
+
+inline void Segmentation::set_batch_probes(bool batch) noexcept {
+  batch_probes_ = batch;
+}
+
+inline LexiconTierStats Segmentation::lexicon_stats() const noexcept {
+  LexiconTierStats stats;
+  stats.hot_hits = hot_hits_;
+  stats.cold_hits = cold_hits_;
+  stats.misses = misses_;
+  return stats;
+}
+
 inline bool Segmentation::contains(const std::string& morph) const {
   return nodes_.find(morph) != nodes_.end();
 }
 
+inline size_t Segmentation::frozen_size() const noexcept {
+  return frozen_ ? frozen_->size() : 0;
+}
+
+inline size_t Segmentation::frozen_bytes() const noexcept {
+  return frozen_ ? frozen_->bytes() : 0;
+}
+
+inline const std::vector<double>& Segmentation::epoch_seconds()
+    const noexcept {
+  return epoch_seconds_;
+}
+
+inline const SpillStats* Segmentation::spill_stats() const noexcept {
+  return spill_ ? &spill_->stats() : nullptr;
+}
+
 inline MorphNode& Segmentation::at(const std::string& morph) {
   return nodes_.at(morph);
 }
@@ -0,0 +1,115 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef INCLUDE_SEGMENTATION_CACHE_H_
+#define INCLUDE_SEGMENTATION_CACHE_H_
+
+#include <cstddef>
+#include <istream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "lexicon_diff.h"
+
+namespace morfessor {
+
+/// Holds the segmentations of a word list made with an earlier model, so
+/// that after retraining only the words that may split differently have to
+/// be segmented again. Each cached word is indexed by the morphs on its best
+/// path, which is what the Viterbi search picked for it.
+class SegmentationCache {
+ public:
+  /// C'tor that reads segmentations in the format written by the --load
+  /// mode, i.e. one word per line with its morphs separated by spaces.
+  explicit SegmentationCache(std::istream& in);
+
+  /// \overload
+  explicit SegmentationCache(std::string segmentation_file);
+
+  /// Returns the number of cached words.
+  size_t size() const noexcept { return words_.size(); }
+
+  /// Returns the words in the order they were read.
+  const std::vector<std::string>& words() const noexcept { return words_; }
+
+  /// Marks every word whose segmentation may change under the new lexicon
+  /// as stale. That is the case if its path uses a morph whose count
+  /// changed or was removed, or if it contains a morph that was added or
+  /// became more frequent. Morph costs are whole steps that also depend on
+  /// the total number of morph tokens, so when that total changes, morphs
+  /// whose cost moved by a step are treated the same way, and so are words
+  /// with a letter missing from the lexicon if its cost moved.
+  /// @param steps_per_nat The resolution of the costs the new lexicon is
+  ///     searched with, as passed to Segmentation::Freeze.
+  /// @return The number of words newly marked as stale.
+  size_t Invalidate(const LexiconDiff& diff, unsigned steps_per_nat = 1);
+
+  /// Returns the cached segmentation of a word, or nullptr if the word is
+  /// not cached or is stale.
+  const std::string* find(const std::string& word) const;
+
+  /// Returns the cached segmentation of a word even if it is stale, or
+  /// nullptr if the word is not cached.
+  const std::string* previous(const std::string& word) const;
+
+ private:
+  void init(std::istream& in);
+
+  /// Marks the words whose path used a morph as stale, and returns how many
+  /// were not stale before.
+  size_t MarkUsers(const std::string& morph);
+
+  /// Words in the order they were read.
+  std::vector<std::string> words_;
+
+  /// Cached segmentation lines, parallel to words_.
+  std::vector<std::string> lines_;
+
+  /// Whether each word needs to be segmented again, parallel to words_.
+  std::vector<bool> stale_;
+
+  /// Maps a word to its position in words_.
+  std::unordered_map<std::string, size_t> index_;
+
+  /// Maps a morph to the positions of the words whose path used it.
+  std::unordered_map<std::string, std::vector<size_t> > users_;
+};
+
+inline const std::string* SegmentationCache::find(
+    const std::string& word) const {
+  auto iter = index_.find(word);
+  if (iter == index_.end() || stale_[iter->second]) {
+    return nullptr;
+  }
+  return &lines_[iter->second];
+}
+
+inline const std::string* SegmentationCache::previous(
+    const std::string& word) const {
+  auto iter = index_.find(word);
+  return iter == index_.end() ? nullptr : &lines_[iter->second];
+}
+
+} // namespace morfessor
+
+#endif /* INCLUDE_SEGMENTATION_CACHE_H_ */
@@ -0,0 +1,183 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef INCLUDE_SHARED_RING_H_
+#define INCLUDE_SHARED_RING_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace morfessor {
+
+/// A ring of word slots in a memory-mapped file, shared by one client and
+/// a segmentation server on the same machine. The client copies words
+/// into the slots and the server writes where their morphs end back into
+/// the same slots, so a round trip costs no system call while the other
+/// side is awake. Each side spins for a while when it runs out of work
+/// and then sleeps on a futex, which the other side only wakes when it
+/// knows that it sleeps.
+class SharedRing {
+ public:
+  /// Number of slots, which is how many words can be in flight.
+  static constexpr size_t kSlots = 1024;
+
+  /// Longest word a slot holds, in bytes.
+  static constexpr size_t kMaxWordBytes = 120;
+
+  /// Most models a ring can name, and the longest name.
+  static constexpr size_t kMaxModels = 16;
+  static constexpr size_t kMaxNameBytes = 31;
+
+  /// One word and, once answered, the offset just past each of its morphs.
+  struct Slot {
+    uint8_t model;
+    uint8_t length;
+    uint8_t morphs;
+    uint8_t unused;
+    char word[kMaxWordBytes];
+    uint8_t ends[kMaxWordBytes];
+    char padding[12];
+  };
+
+  /// C'tor that creates the ring file, for the server, or opens one that
+  /// a server created, for a client. A created file is removed again when
+  /// the object is destroyed. It only appears under its path once it is
+  /// ready, so a client can wait for the path to exist.
+  /// @param path Where the file is, preferably on a tmpfs such as /dev/shm.
+  /// @param models Names of the models, in the order requests number them;
+  ///     only used when creating.
+  SharedRing(const std::string& path, bool create,
+      const std::vector<std::string>& models = {});
+
+  /// D'tor.
+  ~SharedRing();
+
+  SharedRing(const SharedRing&) = delete;
+  SharedRing& operator=(const SharedRing&) = delete;
+
+  /// Returns the index of a model by name, or -1 if the server has none by
+  /// that name.
+  int model(const std::string& name) const;
+
+  /// Returns the slot of the word with the given sequence number.
+  Slot& slot(uint32_t sequence) noexcept;
+
+  /// Sets the number of words requested so far, which must only grow, and
+  /// wakes the server if it sleeps.
+  void PublishRequests(uint32_t requested);
+
+  /// Waits until more than seen words are requested, or the ring is closed.
+  /// @return The number of words requested, which is seen only if the ring
+  ///     was closed with nothing more to answer.
+  uint32_t WaitForRequests(uint32_t seen);
+
+  /// Sets the number of words answered so far, and wakes the client if it
+  /// sleeps.
+  void PublishAnswers(uint32_t answered);
+
+  /// Waits until more than seen words are answered.
+  /// @return The number of words answered.
+  uint32_t WaitForAnswers(uint32_t seen);
+
+  /// Tells the server that no more words will come.
+  void Close();
+
+ private:
+  /// How one side tells the other that there is something new: a count
+  /// that only grows, a flag the other side raises before it sleeps, and
+  /// the futex it sleeps on, which only changes when it is woken.
+  struct Signal {
+    std::atomic<uint32_t> count;
+    std::atomic<uint32_t> sleeps;
+    std::atomic<uint32_t> bell;
+  };
+
+  /// The start of the file. The signals that each side writes are on
+  /// cache lines of their own.
+  struct Header {
+    uint32_t magic;
+    uint32_t models;
+    char names[kMaxModels][kMaxNameBytes + 1];
+    alignas(64) Signal requested;
+    std::atomic<uint32_t> closed;
+    alignas(64) Signal answered;
+  };
+
+  static uint32_t Wait(Signal* signal, const std::atomic<uint32_t>* closed,
+      uint32_t seen);
+  static void Publish(Signal* signal, uint32_t count);
+  static void Ring(Signal* signal);
+
+  std::string path_;
+  bool created_;
+  size_t bytes_;
+  Header* header_;
+  Slot* slots_;
+};
+
+/// The client side of a SharedRing: queues words for the server and reads
+/// the answers in place.
+class RingClient {
+ public:
+  /// C'tor that opens the ring a server created.
+  explicit RingClient(const std::string& path);
+
+  /// D'tor that closes the ring, which stops the server.
+  ~RingClient();
+
+  /// Returns the index of a model by name, or -1.
+  int model(const std::string& name) const { return ring_.model(name); }
+
+  /// Returns how many more words Push takes before Pop must be called.
+  size_t room() const noexcept;
+
+  /// Copies a word into the next free slot. The server does not see it
+  /// until Flush.
+  /// @param model The index of the model to segment the word with.
+  /// @param word The word, at most SharedRing::kMaxWordBytes long.
+  void Push(int model, const char* word, size_t length);
+
+  /// Hands the pushed words to the server.
+  void Flush();
+
+  /// Waits for the answer for the oldest word not popped yet, which must
+  /// have been flushed.
+  /// @param morphs Receives the number of morphs, which is 0 if the model
+  ///     index was unknown to the server.
+  /// @return The offset just past each morph in the word. The offsets are
+  ///     in the shared slot, and stay there until it is pushed to again.
+  const uint8_t* Pop(size_t* morphs);
+
+ private:
+  SharedRing ring_;
+  uint32_t pushed_ = 0;
+  uint32_t flushed_ = 0;
+  uint32_t answered_ = 0;
+  uint32_t popped_ = 0;
+};
+
+} // namespace morfessor
+
+#endif /* INCLUDE_SHARED_RING_H_ */
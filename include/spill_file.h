@@ -0,0 +1,126 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef INCLUDE_SPILL_FILE_H_
+#define INCLUDE_SPILL_FILE_H_
+
+#include <cstddef>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+#include "morph_node.h"
+
+namespace morfessor {
+
+/// Counts the traffic between memory and a spill file.
+struct SpillStats {
+  /// Number of nodes written to the file.
+  size_t evictions = 0;
+
+  /// Number of nodes read back from the file.
+  size_t page_ins = 0;
+
+  /// Number of bytes written, including rewrites during compaction.
+  size_t bytes_written = 0;
+
+  /// Number of bytes read, including reads during compaction.
+  size_t bytes_read = 0;
+
+  /// Number of times the file was rewritten to drop paged in records.
+  size_t compactions = 0;
+};
+
+/// Stores lexicon nodes on disk while they are not needed in memory. Only
+/// a hash of each key and its file offset stay in memory, which is a
+/// fraction of the size of a resident node.
+class SpillFile {
+ public:
+  /// C'tor that creates or truncates the file at the given path. The file is
+  /// removed again when the object is destroyed.
+  explicit SpillFile(std::string path);
+
+  /// D'tor.
+  ~SpillFile();
+
+  /// Writes a node to the file.
+  /// @param morph The key of the node. Must not be in the file already.
+  void Evict(const std::string& morph, const MorphNode& node);
+
+  /// Reads a node back from the file and forgets about it.
+  /// @param morph The key of the node to read.
+  /// @param node Receives the node if it was found.
+  /// @return True if the node was in the file.
+  bool PageIn(const std::string& morph, MorphNode* node);
+
+  /// Reads every node back from the file and empties it.
+  /// @param visit Called with the key and the node of every record.
+  void PageInAll(
+      const std::function<void(std::string, const MorphNode&)>& visit);
+
+  /// Reads every node in the file without removing it.
+  /// @param visit Called with the key and the node of every record.
+  void ForEach(const std::function<void(const std::string&,
+      const MorphNode&)>& visit) const;
+
+  /// Rewrites the file without the records that were paged in, if they
+  /// take up more space than the live ones.
+  void Compact();
+
+  /// Returns the number of nodes in the file.
+  size_t size() const noexcept { return index_.size(); }
+
+  /// Returns the I/O counters.
+  const SpillStats& stats() const noexcept { return stats_; }
+
+ private:
+  /// Appends a record at the end of a file and returns its offset.
+  std::streamoff Write(std::fstream& file, const std::string& morph,
+      const MorphNode& node);
+
+  /// Reads the record at the given offset.
+  void Read(std::streamoff offset, std::string* morph,
+      MorphNode* node) const;
+
+  /// Opens the file at path_, discarding its contents.
+  void Truncate();
+
+  std::string path_;
+
+  /// Reading does not change the contents, but moves the file position.
+  mutable std::fstream file_;
+
+  /// Maps the hash of a key to the offsets of the records with that hash.
+  std::unordered_multimap<size_t, std::streamoff> index_;
+
+  /// Total size of the records in the file, and of the live ones.
+  size_t file_bytes_ = 0;
+  size_t live_bytes_ = 0;
+
+  std::hash<std::string> hash_;
+  mutable SpillStats stats_;
+};
+
+} // namespace morfessor
+
+#endif /* INCLUDE_SPILL_FILE_H_ */
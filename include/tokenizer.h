@@ -0,0 +1,92 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef INCLUDE_TOKENIZER_H_
+#define INCLUDE_TOKENIZER_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <istream>
+#include <vector>
+
+namespace morfessor {
+
+/// Returns true if the byte can be part of a word. Letters are the ASCII
+/// letters and every byte of a multibyte UTF-8 (or Latin-1) character, so
+/// that accented letters are kept inside words.
+inline bool is_word_byte(unsigned char c) noexcept {
+  return c >= 0x80 || static_cast<unsigned char>((c | 0x20) - 'a') < 26;
+}
+
+/// Returns the index of the first word byte in text[pos, size), or size if
+/// there is none. Scans 16 bytes at a time when SSE2 is available.
+size_t FindWordStart(const char* text, size_t pos, size_t size) noexcept;
+
+/// Returns the index of the first byte in text[pos, size) that cannot be
+/// part of a word, or size if there is none. An apostrophe between two word
+/// bytes, as in "action's", does not end the word.
+size_t FindWordEnd(const char* text, size_t pos, size_t size) noexcept;
+
+/// Reads the stream in 64 KiB chunks and calls on_gap(text, length) for each
+/// run of bytes between words and on_word(text, length) for each word, in
+/// the order they appear. A word cut off at the end of a chunk is carried
+/// over, so words are never split across calls.
+template <class OnGap, class OnWord>
+void Tokenize(std::istream& in, OnGap on_gap, OnWord on_word) {
+  constexpr size_t kChunkSize = 1 << 16;
+  std::vector<char> buffer;
+
+  // Bytes at the end of one chunk that may be the start of a word are kept
+  // and read again as the start of the next chunk.
+  size_t carried = 0;
+  bool at_end = false;
+  while (!at_end) {
+    buffer.resize(carried + kChunkSize);
+    in.read(buffer.data() + carried, kChunkSize);
+    auto size = carried + static_cast<size_t>(in.gcount());
+    at_end = !in;
+    const char* text = buffer.data();
+
+    size_t pos = 0;
+    for (;;) {
+      auto word_start = FindWordStart(text, pos, size);
+      if (word_start > pos) {
+        on_gap(text + pos, word_start - pos);
+      }
+      auto word_end = FindWordEnd(text, word_start, size);
+      if (word_start == size || (!at_end && word_end + 1 >= size)) {
+        // The word might continue in the next chunk.
+        pos = word_start;
+        break;
+      }
+      on_word(text + word_start, word_end - word_start);
+      pos = word_end;
+    }
+
+    carried = size - pos;
+    std::copy(buffer.begin() + pos, buffer.begin() + size, buffer.begin());
+  }
+}
+
+} // namespace morfessor
+
+#endif /* INCLUDE_TOKENIZER_H_ */
@@ -0,0 +1,279 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef INCLUDE_VITERBI_LEXICON_H_
+#define INCLUDE_VITERBI_LEXICON_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace morfessor {
+
+/// How many lookups in a ViterbiLexicon each tier answered.
+struct LexiconTierStats {
+  size_t hot_hits = 0;
+  size_t cold_hits = 0;
+  size_t misses = 0;
+};
+
+/// A read-only copy of the morphs of a segmentation with the cost the
+/// Viterbi search gives each of them, laid out for fast lookup. The morphs
+/// are kept end to end in one string and found through an open addressing
+/// table, and the hash of a morph can be built up one letter at a time, so
+/// that all the substrings starting at one position of a word are looked up
+/// without hashing any letter twice.
+///
+/// A cost is kept as a 16 bit fixed point number of steps_per_nat steps per
+/// nat, rounded down. With the default of one step it is the whole number
+/// of nats that ViterbiSplit uses, so the segmentations are the same; more
+/// steps keep more of the fraction that ViterbiSplit drops.
+///
+/// Most hits are on a few thousand frequent morphs. Reorder can pack those,
+/// with their costs, into a small hot array that stays in cache, and lays
+/// the rest out from most to least frequent. Both tiers are found through
+/// the same table, so a miss, which is the most common lookup, still costs
+/// one probe.
+///
+/// A lexicon much larger than the cache makes nearly every lookup a cache
+/// miss. FindBatch takes all the lookups of a batch of words at once and
+/// prefetches the slots of the ones coming up while it resolves the
+/// current one, so that the misses overlap.
+class ViterbiLexicon {
+ public:
+  /// Returned by Find for a morph that is not in the lexicon.
+  static constexpr int kMissing = -1;
+
+  /// A morph to look up with FindBatch.
+  struct Probe {
+    const char* morph;
+    size_t length;
+    /// The result of Hash for the morph.
+    uint64_t hash;
+  };
+
+  /// How many probes ahead FindBatch prefetches.
+  static constexpr size_t kPrefetchDistance = 16;
+
+  /// C'tor for an empty lexicon.
+  /// @param total_morph_tokens The number of morph tokens in the
+  ///     segmentation, which the costs are relative to.
+  /// @param steps_per_nat The resolution of the costs. The cost of a morph
+  ///     that occurs once must fit in 16 bits.
+  explicit ViterbiLexicon(size_t total_morph_tokens,
+      unsigned steps_per_nat = 1);
+
+  /// Adds a morph that is not in the lexicon yet.
+  /// @param count How often the morph occurs; must be positive.
+  void Add(const std::string& morph, size_t count);
+
+  /// Lays the morphs out from most to least frequent, and moves up to
+  /// hot_morphs of the most frequent ones into the hot array. Morphs longer
+  /// than kHotKeyBytes stay cold. Call it at most once.
+  void Reorder(size_t hot_morphs);
+
+  /// Changes the count of a morph in place, adding the morph if it is new
+  /// and removing it if the count is 0. The cost is taken relative to the
+  /// current total; call SetTotal once all the counts are set.
+  void SetCount(const std::string& morph, size_t count);
+
+  /// Changes the number of morph tokens the costs are relative to, and
+  /// works out the cost of every morph again.
+  void SetTotal(size_t total_morph_tokens);
+
+  /// Calls visit with every morph and its count, in no particular order.
+  void ForEach(const std::function<void(const std::string&, size_t)>& visit)
+      const;
+
+  /// Returns the cost of a morph in steps, or kMissing. With one step per
+  /// nat, that is the same whole number that Segmentation::ViterbiSplit
+  /// uses.
+  /// @param hash The result of Hash for the morph.
+  /// @param stats If not null, counts the lookup under the tier that
+  ///     answered it.
+  int Find(const char* morph, size_t length, uint64_t hash,
+      LexiconTierStats* stats = nullptr) const;
+
+  /// \overload
+  int Find(const std::string& morph) const;
+
+  /// Looks up many morphs, and sets costs[i] to what Find would return for
+  /// probes[i].
+  void FindBatch(const Probe* probes, size_t count, int* costs,
+      LexiconTierStats* stats = nullptr) const;
+
+  /// Returns the hash of the empty string.
+  static constexpr uint64_t HashStart() noexcept;
+
+  /// Returns the hash of a string extended by one letter.
+  static constexpr uint64_t HashStep(uint64_t hash, char letter) noexcept;
+
+  /// Returns the hash of a string.
+  static uint64_t Hash(const char* morph, size_t length) noexcept;
+
+  /// Returns the length of the longest morph.
+  size_t max_length() const noexcept { return max_length_; }
+
+  /// Returns the number of morphs.
+  size_t size() const noexcept {
+    return entries_.size() + hot_size_ - removed_;
+  }
+
+  /// Returns the bytes taken by the table, the morphs and their counts.
+  size_t bytes() const noexcept;
+
+  /// Returns the number of morph tokens the costs are relative to.
+  size_t total_morph_tokens() const noexcept { return total_morph_tokens_; }
+
+  /// Returns the number of morphs in the hot array.
+  size_t hot_size() const noexcept { return hot_size_; }
+
+  /// Returns the resolution of the costs.
+  unsigned steps_per_nat() const noexcept { return steps_per_nat_; }
+
+  /// The longest morph that can be kept in the hot array.
+  static constexpr size_t kHotKeyBytes = 29;
+
+ private:
+  struct Entry {
+    uint32_t offset;
+    uint16_t length;
+    uint16_t cost;
+  };
+
+  /// A hot morph, stored with its cost in half a cache line.
+  struct HotEntry {
+    uint16_t cost;
+    uint8_t length;
+    char key[kHotKeyBytes];
+  };
+
+  /// A slot of the table: the high bits of the hash, and one plus the
+  /// index of the hot entry, or of the cold entry after the hot ones; zero
+  /// if the slot is empty.
+  struct Slot {
+    uint32_t tag;
+    uint32_t entry;
+  };
+
+  /// Returns the bytes of a hot or cold entry, by its index in the slots.
+  /// A removed entry has length 0, which no lookup matches.
+  const char* key(size_t index) const noexcept;
+  size_t length(size_t index) const noexcept;
+
+  /// Returns the index of a morph in the slots, or -1 if it is missing.
+  size_t Locate(const std::string& morph) const;
+
+  /// Returns the cost of a count relative to the current total.
+  uint16_t Cost(size_t count) const;
+
+  /// Sets the cost of an entry, or its length to remove it.
+  void SetCost(size_t index, uint16_t cost);
+  void SetLength(size_t index, size_t length);
+
+  /// Makes a table with the given number of slots and puts every entry in.
+  void Rehash(size_t slots);
+
+  /// Puts an entry in the first free slot for its hash.
+  void Insert(uint64_t hash, uint32_t entry);
+
+  /// The morphs, end to end.
+  std::string text_;
+  std::vector<Entry> entries_;
+  /// How often each entry occurs, hot entries first.
+  std::vector<size_t> counts_;
+  std::vector<Slot> slots_;
+  std::vector<HotEntry> hot_;
+  size_t hot_size_ = 0;
+  size_t removed_ = 0;
+  size_t mask_ = 0;
+  size_t max_length_ = 0;
+  size_t total_morph_tokens_;
+  double log_token_count_;
+  unsigned steps_per_nat_;
+};
+
+constexpr uint64_t ViterbiLexicon::HashStart() noexcept {
+  return 14695981039346656037ull;
+}
+
+constexpr uint64_t ViterbiLexicon::HashStep(uint64_t hash,
+    char letter) noexcept {
+  return (hash ^ static_cast<unsigned char>(letter)) * 1099511628211ull;
+}
+
+inline uint64_t ViterbiLexicon::Hash(const char* morph,
+    size_t length) noexcept {
+  auto hash = HashStart();
+  for (size_t i = 0; i < length; ++i) {
+    hash = HashStep(hash, morph[i]);
+  }
+  return hash;
+}
+
+inline int ViterbiLexicon::Find(const char* morph, size_t length,
+    uint64_t hash, LexiconTierStats* stats) const {
+  // FNV mixes the last letter into the low bits only weakly, so fold the
+  // high bits in before picking a slot.
+  auto tag = static_cast<uint32_t>(hash >> 32);
+  for (auto i = (hash ^ tag) & mask_; slots_[i].entry != 0;
+      i = (i + 1) & mask_) {
+    if (slots_[i].tag != tag) {
+      continue;
+    }
+    size_t index = slots_[i].entry - 1;
+    if (index < hot_size_) {
+      const auto& entry = hot_[index];
+      if (entry.length == length
+          && std::memcmp(entry.key, morph, length) == 0) {
+        if (stats != nullptr) {
+          ++stats->hot_hits;
+        }
+        return entry.cost;
+      }
+    } else {
+      const auto& entry = entries_[index - hot_size_];
+      if (entry.length == length
+          && text_.compare(entry.offset, length, morph, length) == 0) {
+        if (stats != nullptr) {
+          ++stats->cold_hits;
+        }
+        return entry.cost;
+      }
+    }
+  }
+  if (stats != nullptr) {
+    ++stats->misses;
+  }
+  return kMissing;
+}
+
+inline int ViterbiLexicon::Find(const std::string& morph) const {
+  return Find(morph.data(), morph.size(), Hash(morph.data(), morph.size()));
+}
+
+}  // namespace morfessor
+
+#endif /* INCLUDE_VITERBI_LEXICON_H_ */
@@ -0,0 +1,107 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef INCLUDE_WORD_COUNTER_H_
+#define INCLUDE_WORD_COUNTER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "corpus.h"
+
+namespace morfessor {
+
+/// A count-min sketch: depth rows of width counters, where each key adds to
+/// one counter per row and its count is estimated by the smallest of them.
+/// Estimates never fall below the true count, and with probability
+/// 1 - exp(-depth) exceed it by at most e / width times the total count.
+class CountMinSketch {
+ public:
+  CountMinSketch(size_t width, size_t depth);
+
+  /// Adds one occurrence of the key with the given hash. Only the counters
+  /// that equal the current estimate are raised (conservative update), which
+  /// keeps the overestimates of rare keys down.
+  void Add(size_t hash) noexcept;
+
+  /// Returns the estimated count of the key with the given hash.
+  uint32_t Estimate(size_t hash) const noexcept;
+
+  /// Returns the number of bytes used by the counters.
+  size_t bytes() const noexcept { return counters_.size() * sizeof(uint32_t); }
+
+  size_t width() const noexcept { return width_; }
+  size_t depth() const noexcept { return depth_; }
+
+ private:
+  size_t index(size_t hash, size_t row) const noexcept;
+
+  size_t width_;
+  size_t depth_;
+  std::vector<uint32_t> counters_;
+};
+
+/// Settings for counting the words of raw text.
+struct WordCountOptions {
+  /// Counters per sketch row. 0 counts every word exactly.
+  size_t sketch_width = 0;
+  /// Number of sketch rows.
+  size_t sketch_depth = 4;
+  /// Number of frequent words whose counts are kept exactly.
+  size_t heavy_hitters = 65536;
+};
+
+/// What counting the words of raw text used and produced.
+struct WordCountStats {
+  /// Number of words in the text.
+  size_t tokens = 0;
+  /// Number of word types with exact counts.
+  size_t heavy_words = 0;
+  /// Most word types the table of exact counts held at once.
+  size_t peak_heavy_words = 0;
+  /// Number of word types with sketch counts.
+  size_t tail_words = 0;
+  /// Approximate peak memory used for counting, not including the corpus.
+  size_t counting_bytes = 0;
+  /// Overestimate that a sketch count stays within with probability
+  /// 1 - exp(-depth), or 0 for exact counts.
+  double error_bound = 0;
+};
+
+/// Builds a word list from raw text, lowercasing every word. With a sketch,
+/// the text is read twice: the first pass fills the sketch and keeps the
+/// words that look most frequent, and the second counts those words exactly
+/// and gives every other word its sketch estimate. Apart from the hash of
+/// each rare word, which is kept so that the word is listed only once,
+/// counting memory is then fixed by the options, whatever the number of
+/// word types.
+/// @param text_file The text to count; must be a file, not a pipe.
+/// @param options The sketch sizes.
+/// @param stats If not null, filled with counting statistics.
+Corpus CountWords(const std::string& text_file,
+    const WordCountOptions& options, WordCountStats* stats = nullptr);
+
+} // namespace morfessor
+
+#endif /* INCLUDE_WORD_COUNTER_H_ */
@@ -0,0 +1,111 @@
+#!/bin/bash
+
+# The MIT License (MIT)
+#
+# Copyright (c) 2016 Derek Felson
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+# Runs this implementation and the reference Perl implementation of
+# Morfessor Baseline on identical inputs and parameters, and reports wall
+# time, peak memory, final cost and F-measure side by side for each
+# language. Both programs train with the plain Baseline cost model and a
+# convergence threshold of 0.005 per word type.
+
+morfessor="${MORFESSOR:-../build/morfessor}"
+morfessorRef="./morfessor-reference.perl"
+evalscript="./morpho-challenge-eval.perl"
+
+wordlist="../testdata/morpho-challenge-2005-wordlist"
+testlist="../testdata/morpho-challenge-2005-testset"
+goldstd="../testdata/morpho-challenge-2005-goldstd"
+outdir="results/parity"
+languages="${LANGUAGES:-english finnish turkish}"
+
+# Runs a command with stdout sent to the given file, and prints the wall
+# time in seconds and the peak resident set size in kilobytes. The peak is
+# sampled from /proc while the command runs.
+measure() {
+    out="$1"
+    shift
+    start=$(date +%s.%N)
+    "$@" > "$out" &
+    pid=$!
+    peak=0
+    while kill -0 "$pid" 2> /dev/null; do
+        hwm=$(awk '/^VmHWM:/ { print $2 }' "/proc/$pid/status" 2> /dev/null)
+        if [ -n "$hwm" ] && [ "$hwm" -gt "$peak" ]; then
+            peak="$hwm"
+        fi
+        sleep 0.1
+    done
+    wait "$pid"
+    end=$(date +%s.%N)
+    awk -v start="$start" -v end="$end" -v peak="$peak" \
+        'BEGIN { printf "%.2f %d\n", end - start, peak }'
+}
+
+fmeasure() {
+    sed -n 's/^F-measure: *\([0-9.]*\)%.*/\1/p' "$1"
+}
+
+parity() {
+    language="$1"
+    dir="$outdir/$language"
+    mkdir -p "$dir/cpp" "$dir/ref"
+
+    # C++ implementation
+    read -r cpp_time cpp_mem < <(measure "$dir/cpp/model.txt" \
+        "$morfessor" --mode Baseline --finish 0.005 \
+        --data "$wordlist-${language}.txt")
+    cpp_cost=$(sed -n '1s/^Overall cost: //p' "$dir/cpp/model.txt")
+    "$morfessor" --mode Baseline --load "$dir/cpp/model.txt" \
+        --data "$testlist-${language}.txt" > "$dir/cpp/test-segmentation.txt"
+    "$evalscript" -desired "$goldstd-${language}.txt" \
+        -suggested "$dir/cpp/test-segmentation.txt" > "$dir/cpp/results.txt"
+
+    # Reference implementation. Trace level 2 makes it print the cost after
+    # every epoch; the last one is the final cost.
+    read -r ref_time ref_mem < <(measure "$dir/ref/model.txt" \
+        "$morfessorRef" -finish 0.005 -rand 0 -trace 2 \
+        -data "$wordlist-${language}.txt")
+    ref_cost=$(sed -n 's/^# OVERALL logprob: //p' "$dir/ref/model.txt" \
+        | tail -n 1)
+    "$morfessorRef" -load "$dir/ref/model.txt" \
+        -data "$testlist-${language}.txt" \
+        | sed -e "s/^1 //" -e "s/ + / /g" -e "/^#.*/d" \
+        > "$dir/ref/test-segmentation.txt"
+    "$evalscript" -desired "$goldstd-${language}.txt" \
+        -suggested "$dir/ref/test-segmentation.txt" > "$dir/ref/results.txt"
+
+    printf "%-8s %-4s %10.2f %12d %16.2f %8s\n" "$language" "c++" \
+        "$cpp_time" "$cpp_mem" "$cpp_cost" "$(fmeasure "$dir/cpp/results.txt")"
+    printf "%-8s %-4s %10.2f %12d %16.2f %8s\n" "$language" "perl" \
+        "$ref_time" "$ref_mem" "$ref_cost" "$(fmeasure "$dir/ref/results.txt")"
+    return 0
+}
+
+mkdir -p "$outdir"
+{
+    printf "%-8s %-4s %10s %12s %16s %8s\n" "language" "impl" "seconds" \
+        "peak_rss_kb" "final_cost" "F%"
+    for language in $languages; do
+        parity "$language"
+    done
+} | tee "$outdir/summary.txt"
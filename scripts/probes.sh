@@ -0,0 +1,85 @@
+#!/bin/bash
+
+# The MIT License (MIT)
+#
+# Copyright (c) 2016 Derek Felson
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+# Measures how much looking morphs up in prefetched groups speeds up
+# segmentation with a lexicon larger than the cache. A model is trained on
+# the words of each word list that occur at least twice, unless one is
+# already there, and the whole word list is then segmented with it a few
+# times with --batch_probes off and on, in turns. The fastest segmentation
+# time of each setting is reported.
+
+morfessor="${MORFESSOR:-../build/morfessor}"
+
+wordlist="../testdata/morpho-challenge-2005-wordlist"
+outdir="results/probes"
+languages="${LANGUAGES:-finnish turkish}"
+repeats="${REPEATS:-5}"
+
+# Prints the segment_seconds of one run.
+segment_seconds() {
+    "$morfessor" --load "$1" --data "$2" --batch_probes="$3" --stats \
+        2>&1 > /dev/null | tr ' ' '\n' | sed -n 's/^segment_seconds=//p'
+}
+
+probes() {
+    language="$1"
+    model="$outdir/${language}-model.txt"
+    data="$wordlist-${language}.txt"
+
+    if [ ! -s "$model" ]; then
+        "$morfessor" --train_min_count 2 --seed 4711 --data "$data" \
+            > "$model"
+    fi
+    morphs=$(grep -vc '^Overall cost:' "$model")
+
+    single=""
+    batched=""
+    for _ in $(seq "$repeats"); do
+        single="$single $(segment_seconds "$model" "$data" false)"
+        batched="$batched $(segment_seconds "$model" "$data" true)"
+    done
+    awk -v language="$language" -v morphs="$morphs" \
+        -v single="$single" -v batched="$batched" '
+        function fastest(times,    n, t, i, best) {
+            n = split(times, t, " ")
+            best = t[1]
+            for (i = 2; i <= n; ++i) if (t[i] < best) best = t[i]
+            return best
+        }
+        BEGIN {
+            s = fastest(single); b = fastest(batched)
+            printf "%-8s %10d %14.3f %14.3f %8.2f\n", language, morphs, s, b,
+                (b > 0 ? s / b : 0)
+        }'
+    return 0
+}
+
+mkdir -p "$outdir"
+{
+    printf "%-8s %10s %14s %14s %8s\n" "language" "morphs" "single_seconds" \
+        "batched_seconds" "speedup"
+    for language in $languages; do
+        probes "$language"
+    done
+} | tee "$outdir/summary.txt"
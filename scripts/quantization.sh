@@ -0,0 +1,80 @@
+#!/bin/bash
+
+# The MIT License (MIT)
+#
+# Copyright (c) 2016 Derek Felson
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+# Measures what finer morph costs do to the segmentation of the Morpho
+# Challenge gold standard words. A model is trained on the words of each
+# word list that occur at least twice, unless one is already there. The
+# gold standard words are then segmented with the model at several
+# --steps_per_nat, and each run is compared with the whole nat costs that
+# training uses: how many words are split differently, and the F-measure
+# against the gold standard.
+
+morfessor="${MORFESSOR:-../build/morfessor}"
+evalscript="./morpho-challenge-eval.perl"
+
+wordlist="../testdata/morpho-challenge-2005-wordlist"
+goldstd="../testdata/morpho-challenge-2005-goldstd"
+outdir="results/quantization"
+languages="${LANGUAGES:-english finnish turkish}"
+steps="${STEPS:-1 2 4 16 256}"
+
+fmeasure() {
+    sed -n 's/^F-measure: *\([0-9.]*\)%.*/\1/p' "$1"
+}
+
+quantization() {
+    language="$1"
+    model="$outdir/${language}-model.txt"
+    words="$outdir/${language}-words.txt"
+
+    if [ ! -s "$model" ]; then
+        "$morfessor" --train_min_count 2 --seed 4711 \
+            --data "$wordlist-${language}.txt" > "$model"
+    fi
+    cut -f 1 "$goldstd-${language}.txt" | sed 's/^/1 /' > "$words"
+
+    for step in $steps; do
+        segmentation="$outdir/${language}-${step}.txt"
+        "$morfessor" --load "$model" --data "$words" \
+            --steps_per_nat "$step" > "$segmentation"
+        "$evalscript" -desired "$goldstd-${language}.txt" \
+            -suggested "$segmentation" > "$outdir/${language}-${step}-results.txt"
+        changed=$(paste -d '\n' "$outdir/${language}-1.txt" "$segmentation" \
+            | awk 'NR % 2 == 1 { line = $0; next } $0 != line { ++n }
+                END { print n + 0 }')
+        printf "%-8s %6s %8d %8d %8s\n" "$language" "$step" \
+            "$(wc -l < "$words")" "$changed" \
+            "$(fmeasure "$outdir/${language}-${step}-results.txt")"
+    done
+    return 0
+}
+
+mkdir -p "$outdir"
+{
+    printf "%-8s %6s %8s %8s %8s\n" "language" "steps" "words" "changed" \
+        "F%"
+    for language in $languages; do
+        quantization "$language"
+    done
+} | tee "$outdir/summary.txt"
@@ -0,0 +1,63 @@
+#!/bin/bash
+
+# The MIT License (MIT)
+#
+# Copyright (c) 2016 Derek Felson
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+# Compares the round trip time of the two ways of talking to a morfessor
+# --models server: lines through its stdin and stdout, and the ring in
+# shared memory. The English word list is sent a word at a time and in
+# larger batches, with a model trained on it unless one is already there.
+# Each line gives the time per word and the median and 99th percentile
+# round trip.
+
+morfessor="${MORFESSOR:-../build/morfessor}"
+client="${RING_CLIENT:-../build/morfessor-ring-client}"
+
+data="../data/wordlist.eng"
+outdir="results/ring"
+ring="${RING:-/dev/shm/morfessor-ring-$$}"
+batches="${BATCHES:-1 16 256}"
+
+# Prints the report of one client run without its transport.
+report() {
+    "$client" "$@" --data "$data" 2>&1 >/dev/null | cut -d' ' -f2-
+}
+
+mkdir -p "$outdir"
+model="$outdir/english-model.txt"
+if [ ! -s "$model" ]; then
+    "$morfessor" --train_min_count 2 --seed 4711 --data "$data" > "$model"
+fi
+
+{
+    for batch in $batches; do
+        echo "stream in_flight=$batch" \
+            "$(report --server "$morfessor --models en=$model" \
+                --in_flight "$batch")"
+
+        "$morfessor" --models "en=$model" --ring "$ring" &
+        server=$!
+        echo "ring   in_flight=$batch" \
+            "$(report --ring "$ring" --in_flight "$batch")"
+        wait "$server"
+    done
+} | tee "$outdir/summary.txt"
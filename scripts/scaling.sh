@@ -0,0 +1,103 @@
+#!/bin/bash
+
+# The MIT License (MIT)
+#
+# Copyright (c) 2016 Derek Felson
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+# Measures how training time and memory grow with vocabulary size. Each word
+# list is subsampled at a series of fractions with a fixed seed, a model is
+# trained on every sample, and the results are written as a table together
+# with the exponents of a power law fitted to them, i.e. b in y = a * x^b
+# where x is the number of word types in the sample.
+
+morfessor="../build/morfessor"
+
+wordlist="../testdata/morpho-challenge-2005-wordlist"
+outdir="results/scaling"
+seed=4711
+percentages="1 2 5 10 20 50 100"
+
+# Keeps each line of a word list with the given probability (in percent).
+# awk's generator is deterministic for a given seed, so repeated runs see
+# the same samples.
+subsample() {
+    awk -v seed="$seed" -v pct="$2" \
+        'BEGIN { srand(seed) } rand() * 100 < pct' "$1"
+}
+
+scale() {
+    args="$1"
+    language="$2"
+    table="$outdir/${language}.txt"
+
+    mkdir -p "$outdir"
+    printf "%-8s %10s %7s %12s %12s %12s %10s\n" "percent" "types" "epochs" \
+        "seconds" "sec/epoch" "peak_rss_kb" "lexicon" > "$table"
+    for pct in $percentages; do
+        sample="$outdir/${language}-${pct}.txt"
+        subsample "$wordlist-${language}.txt" "$pct" > "$sample"
+        "$morfessor" $args --stats --data "$sample" 2>&1 > /dev/null \
+            | tr ' ' '\n' | awk -F= -v pct="$pct" '
+                { v[$1] = $2 }
+                END {
+                    printf "%-8s %10d %7d %12.3f %12.3f %12d %10d\n", pct,
+                        v["word_types"], v["epochs"], v["train_seconds"],
+                        v["seconds_per_epoch"], v["peak_rss_kb"],
+                        v["lexicon_size"]
+                }' >> "$table"
+        rm -f "$sample"
+    done
+
+    # Least squares fit of log(y) against log(types) for each measurement.
+    awk '
+        function fit(col, name,    i, n, sx, sy, sxx, sxy, x, y) {
+            for (i = 1; i <= rows; ++i) {
+                if (types[i] <= 0 || val[i, col] <= 0) continue
+                x = log(types[i]); y = log(val[i, col])
+                ++n; sx += x; sy += y; sxx += x * x; sxy += x * y
+            }
+            if (n < 2 || n * sxx == sx * sx) {
+                printf "%-12s exponent: n/a\n", name
+                return
+            }
+            printf "%-12s exponent: %.3f\n", name,
+                (n * sxy - sx * sy) / (n * sxx - sx * sx)
+        }
+        NR > 1 {
+            ++rows; types[rows] = $2
+            for (c = 3; c <= 7; ++c) val[rows, c] = $c
+        }
+        END {
+            print ""
+            fit(3, "epochs"); fit(4, "seconds"); fit(5, "sec/epoch")
+            fit(6, "peak_rss_kb"); fit(7, "lexicon")
+        }' "$table" >> "$table"
+
+    cat "$table"
+    return 0
+}
+
+set -o xtrace
+
+scale "--mode Baseline" "finnish"
+scale "--mode Baseline" "turkish"
+
+set +o xtrace
@@ -0,0 +1,96 @@
+#!/bin/bash
+
+# The MIT License (MIT)
+#
+# Copyright (c) 2016 Derek Felson
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+# Measures what counting raw text with the count-min sketch does to the final
+# model. Running text is made from a word list by repeating each word in
+# proportion to its count, its words are counted exactly and with sketches of
+# decreasing width, and a model is trained on each count. The table lists the
+# memory used for counting, the error bound of the counts and the final
+# model cost relative to the model trained on exact counts.
+
+morfessor="../build/morfessor"
+
+wordlist="../testdata/morpho-challenge-2005-wordlist"
+outdir="results/sketch"
+seed=4711
+scale=10
+widths="0 1048576 262144 65536 16384"
+heavy_hitters=8192
+
+# Writes each word of the list count / scale times, rounding the fraction up
+# or down at random with a fixed seed, twelve words to a sentence.
+make_text() {
+    awk -v seed="$seed" -v scale="$scale" '
+        BEGIN { srand(seed) }
+        {
+            n = int($1 / scale)
+            if (rand() < $1 / scale - n) ++n
+            for (i = 0; i < n; ++i) {
+                printf "%s%s", $2, (++k % 12 == 0 ? ".\n" : " ")
+            }
+        }' "$1"
+}
+
+compare() {
+    args="$1"
+    language="$2"
+    table="$outdir/${language}.txt"
+    text="$outdir/${language}-text.txt"
+
+    mkdir -p "$outdir"
+    make_text "$wordlist-${language}.txt" > "$text"
+    printf "%-9s %10s %10s %14s %12s %10s %14s %10s\n" "width" "exact" \
+        "sketched" "counting_kb" "error_bound" "lexicon" "cost" \
+        "cost_diff%" > "$table"
+    for width in $widths; do
+        "$morfessor" $args --stats --train_text "$text" \
+            --sketch_width "$width" --heavy_hitters "$heavy_hitters" \
+            2>&1 > /dev/null \
+            | tr ' ' '\n' | awk -F= -v width="$width" '
+                { v[$1] = $2 }
+                END {
+                    printf "%-9s %10d %10d %14d %12.1f %10d %14.1f\n", width,
+                        v["exact_words"], v["sketch_words"],
+                        v["counting_bytes"] / 1024, v["count_error_bound"],
+                        v["lexicon_size"], v["overall_cost"]
+                }' >> "$table"
+    done
+    rm -f "$text"
+
+    # The first row is the exact count, which the others are compared with.
+    awk 'NR == 1 { print; next }
+        NR == 2 { exact = $7 }
+        { printf "%s %10.3f\n", $0, 100 * ($7 - exact) / exact }' \
+        "$table" > "$table.tmp"
+    mv "$table.tmp" "$table"
+
+    cat "$table"
+    return 0
+}
+
+set -o xtrace
+
+compare "--mode Baseline" "english"
+
+set +o xtrace
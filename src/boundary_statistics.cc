@@ -0,0 +1,131 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "boundary_statistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <string>
+
+namespace morfessor {
+
+BoundaryStatistics::BoundaryStatistics(const Corpus& words, size_t min_types)
+    : min_types_{min_types}, offsets_{}, scores_{} {
+  auto begin = words.cbegin();
+  auto count = static_cast<size_t>(words.cend() - begin);
+
+  // One score per position 0..length of each word, so that score() can
+  // index by boundary position directly.
+  offsets_.reserve(count + 1);
+  size_t total = 0;
+  for (auto iter = begin; iter != words.cend(); ++iter) {
+    offsets_.push_back(total);
+    total += iter->length() + 1;
+  }
+  offsets_.push_back(total);
+  scores_.assign(total, 0.0f);
+
+  std::vector<size_t> order(count);
+  std::iota(order.begin(), order.end(), 0);
+
+  std::sort(order.begin(), order.end(), [begin](size_t a, size_t b) {
+    return begin[a].letters() < begin[b].letters();
+  });
+  Accumulate(words, order, [begin](size_t word, size_t depth) {
+    return begin[word].letters()[depth];
+  }, false);
+
+  std::sort(order.begin(), order.end(), [begin](size_t a, size_t b) {
+    const auto& x = begin[a].letters();
+    const auto& y = begin[b].letters();
+    return std::lexicographical_compare(x.rbegin(), x.rend(),
+        y.rbegin(), y.rend());
+  });
+  Accumulate(words, order, [begin](size_t word, size_t depth) {
+    const auto& letters = begin[word].letters();
+    return letters[letters.size() - 1 - depth];
+  }, true);
+}
+
+template <class LetterAt>
+void BoundaryStatistics::Accumulate(const Corpus& words,
+    const std::vector<size_t>& order, LetterAt letter_at, bool reversed) {
+  // Sorted words sharing a prefix of length depth form a run. The stack
+  // holds the open runs of the current word, one per depth. A run is closed
+  // when a word no longer shares its prefix, at which point the sizes of
+  // its child runs (one per next letter, plus one for a word ending there)
+  // give its entropy.
+  struct Run {
+    size_t depth;
+    size_t start;
+    size_t types;
+    double sum_n_log_n;
+  };
+  auto begin = words.cbegin();
+  std::vector<Run> stack{{0, 0, 0, 0.0}};
+
+  auto close = [&](size_t end) {
+    auto run = stack.back();
+    stack.pop_back();
+    if (run.types >= min_types_ && run.types > 0) {
+      auto entropy = static_cast<float>(std::log(run.types)
+          - run.sum_n_log_n / run.types);
+      for (auto i = run.start; i < end; ++i) {
+        auto word = order[i];
+        auto length = begin[word].length();
+        if (run.depth < length) {
+          auto position = reversed ? length - run.depth : run.depth;
+          scores_[offsets_[word] + position] += entropy;
+        }
+      }
+    }
+    double size = end - run.start;
+    stack.back().types += end - run.start;
+    stack.back().sum_n_log_n += size * std::log(size);
+  };
+
+  for (size_t k = 0; k < order.size(); ++k) {
+    auto length = begin[order[k]].length();
+    size_t common = 0;
+    if (k > 0) {
+      auto previous_length = begin[order[k - 1]].length();
+      while (common < length && common < previous_length
+          && letter_at(order[k - 1], common) == letter_at(order[k], common)) {
+        ++common;
+      }
+    }
+    while (stack.back().depth > common) {
+      close(k);
+    }
+    for (auto depth = stack.back().depth + 1; depth <= length; ++depth) {
+      stack.push_back({depth, k, 0, 0.0});
+    }
+    // The word itself ends the run of its full length.
+    ++stack.back().types;
+  }
+  while (stack.size() > 1) {
+    close(order.size());
+  }
+}
+
+} // namespace morfessor
@@ -22,38 +22,165 @@
 
 #include "corpus.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <fstream>
+#include <iterator>
 #include <sstream>
+#include <utility>
 
+#include "front_coded_dictionary.h"
 #include "morph.h"
 
 namespace morfessor
 {
 
+namespace {
+
+/// Returns the first position in [pos, end) whose bit in bits is set, or
+/// clear if flip is all ones, or end if there is none.
+inline size_t NextBit(const uint64_t* bits, size_t pos, size_t end,
+    uint64_t flip) noexcept {
+  while (pos < end) {
+    auto word = (bits[pos / 64] ^ flip) >> (pos % 64);
+    if (word != 0) {
+      return std::min(end, pos + __builtin_ctzll(word));
+    }
+    pos = (pos / 64 + 1) * 64;
+  }
+  return end;
+}
+
+}  // namespace
+
 Corpus::Corpus(std::istream& in) {
   init(in);
 }
 
+constexpr char Corpus::kFrontCodedMagic[];
+
 Corpus::Corpus(std::string word_file)
 : words_{}
 {
-	std::ifstream file{word_file};
+	std::ifstream file{word_file, std::ios::binary};
 	assert(file.is_open());
+	char magic[sizeof(kFrontCodedMagic) - 1] = {};
+	file.read(magic, sizeof(magic));
+	if (file && std::memcmp(magic, kFrontCodedMagic, sizeof(magic)) == 0) {
+		// The overall cost comes next, which only matters to people.
+		double cost;
+		file.read(reinterpret_cast<char*>(&cost), sizeof(cost));
+		FrontCodedDictionary dictionary{file};
+		assert(file && "the front coded model is cut off or corrupt");
+		words_.reserve(dictionary.size());
+		dictionary.ForEach([this](const std::string& letters, size_t count) {
+			words_.emplace_back(letters, count);
+		});
+		return;
+	}
+	file.clear();
+	file.seekg(0);
 	init(file);
 }
 
+Corpus::Corpus(std::vector<Morph> words)
+: words_{std::move(words)}
+{
+}
+
 void Corpus::init(std::istream& in) {
-  std::string line;
-  while (getline(in, line))
-  {
-    std::stringstream ssline{line};
-    size_t freq;
-    std::string morph_string;
-    ssline >> freq;
-    ssline >> morph_string;
-    words_.emplace_back(morph_string, freq);
+  ParseStream(in, [this](std::vector<Morph>* words) {
+    if (words_.empty()) {
+      words_.swap(*words);
+    } else {
+      words_.insert(words_.end(), std::make_move_iterator(words->begin()),
+          std::make_move_iterator(words->end()));
+    }
+  });
+}
+
+void Corpus::ParseStream(std::istream& in,
+    const std::function<void(std::vector<Morph>* words)>& parsed) {
+  constexpr size_t kChunkSize = 1 << 20;
+  std::vector<char> buffer;
+  std::vector<Morph> words;
+
+  // A line cut off at the end of one chunk is carried over to the next.
+  size_t carried = 0;
+  bool at_end = false;
+  while (!at_end) {
+    buffer.resize(carried + kChunkSize);
+    in.read(buffer.data() + carried, kChunkSize);
+    auto size = carried + static_cast<size_t>(in.gcount());
+    at_end = !in;
+    words.clear();
+    auto used = ParseLines(buffer.data(), size, at_end, &words);
+    carried = size - used;
+    if (used > 0 && carried > 0) {
+      std::memmove(buffer.data(), buffer.data() + used, carried);
+    }
+    if (!words.empty()) {
+      parsed(&words);
+    }
+  }
+}
+
+size_t Corpus::ParseLines(const char* text, size_t size, bool at_end,
+    std::vector<Morph>* words, ScanLevel level) {
+  // A last partial block is scanned from a copy padded with zeros, which
+  // are neither newlines nor blanks.
+  auto blocks = (size + 63) / 64;
+  std::vector<uint64_t> newlines(blocks);
+  std::vector<uint64_t> blanks(blocks);
+  ScanBlocks(text, size / 64, newlines.data(), blanks.data(), level);
+  if (size % 64 != 0) {
+    char tail[64] = {};
+    std::memcpy(tail, text + size / 64 * 64, size % 64);
+    ScanBlocks(tail, 1, &newlines[blocks - 1], &blanks[blocks - 1], level);
   }
+
+  size_t start = 0;
+  while (start < size) {
+    auto end = NextBit(newlines.data(), start, size, 0);
+    if (end == size && !at_end) {
+      break;
+    }
+    // The count runs from the first byte that is not blank to the next
+    // blank, and the word from the next byte that is not blank to the
+    // blank or line end after it.
+    auto count_start = NextBit(blanks.data(), start, end, ~0ULL);
+    auto count_end = NextBit(blanks.data(), count_start, end, 0);
+    auto word_start = NextBit(blanks.data(), count_end, end, ~0ULL);
+    auto word_end = NextBit(blanks.data(), word_start, end, 0);
+    auto length = count_end - count_start;
+    char digits[8] = {};
+    const char* count_text = text + count_start;
+    if (length <= 8 && count_start + 8 > size) {
+      // ParseCount reads 8 bytes for a short count.
+      std::memcpy(digits, count_text, std::min<size_t>(length, 8));
+      count_text = digits;
+    }
+    size_t count;
+    if (word_start < end && ParseCount(count_text, length, &count)) {
+      words->emplace_back(std::string(text + word_start,
+          word_end - word_start), count);
+    } else {
+      words->push_back(ParseLine(std::string(text + start, end - start)));
+    }
+    start = end + 1;
+  }
+  return std::min(start, size);
+}
+
+Morph Corpus::ParseLine(const std::string& line) {
+  // A blank line fails before the count is read, which leaves it unset.
+  std::stringstream ssline{line};
+  size_t freq = 0;
+  std::string morph_string;
+  ssline >> freq;
+  ssline >> morph_string;
+  return Morph{morph_string, freq};
 }
 
 } // namespace morfessor
@@ -0,0 +1,260 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "front_coded_dictionary.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <utility>
+
+namespace morfessor {
+
+constexpr size_t FrontCodedDictionary::kBlockSize;
+
+namespace {
+
+void PutVarint(uint64_t value, std::string* out) {
+  while (value >= 0x80) {
+    *out += static_cast<char>((value & 0x7f) | 0x80);
+    value >>= 7;
+  }
+  *out += static_cast<char>(value);
+}
+
+uint64_t GetVarint(const char** in) {
+  uint64_t value = 0;
+  for (int shift = 0;; shift += 7) {
+    auto byte = static_cast<unsigned char>(*(*in)++);
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (byte < 0x80) {
+      return value;
+    }
+  }
+}
+
+/// Like GetVarint, but fails instead of reading at or past end or beyond 64
+/// bits.
+bool GetVarintChecked(const char** in, const char* end, uint64_t* value) {
+  *value = 0;
+  for (int shift = 0; shift < 64 && *in < end; shift += 7) {
+    auto byte = static_cast<unsigned char>(*(*in)++);
+    *value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (byte < 0x80) {
+      return true;
+    }
+  }
+  return false;
+}
+
+template <typename T>
+void WriteValue(std::ostream& out, T value) {
+  out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+bool ReadValue(std::istream& in, T* value) {
+  return static_cast<bool>(
+      in.read(reinterpret_cast<char*>(value), sizeof(*value)));
+}
+
+/// Returns the number of bytes left in a seekable stream, or 0 if it cannot
+/// tell.
+uint64_t RemainingBytes(std::istream& in) {
+  auto position = in.tellg();
+  if (position < 0 || !in.seekg(0, std::ios::end)) {
+    in.clear();
+    return 0;
+  }
+  auto end = in.tellg();
+  in.seekg(position);
+  return end > position ? static_cast<uint64_t>(end - position) : 0;
+}
+
+}  // namespace
+
+FrontCodedDictionary::FrontCodedDictionary(std::vector<Morph> entries)
+    : size_{entries.size()} {
+  std::sort(entries.begin(), entries.end(),
+      [](const Morph& a, const Morph& b) {
+        return a.letters() < b.letters();
+      });
+  const std::string* previous = nullptr;
+  for (size_t i = 0; i < entries.size(); ++i) {
+    const auto& letters = entries[i].letters();
+    if (i % kBlockSize == 0) {
+      block_offsets_.push_back(static_cast<uint32_t>(data_.size()));
+      PutVarint(letters.size(), &data_);
+      data_ += letters;
+    } else {
+      assert(letters != *previous);
+      size_t shared = 0;
+      auto most = std::min(letters.size(), previous->size());
+      while (shared < most && letters[shared] == (*previous)[shared]) {
+        ++shared;
+      }
+      PutVarint(shared, &data_);
+      PutVarint(letters.size() - shared, &data_);
+      data_.append(letters, shared, std::string::npos);
+    }
+    PutVarint(entries[i].frequency(), &data_);
+    previous = &letters;
+  }
+}
+
+FrontCodedDictionary::FrontCodedDictionary(std::istream& in) {
+  // The lengths come from the file, so each one is checked against what is
+  // left of the stream before anything is allocated for it.
+  uint64_t size = 0;
+  uint64_t data_bytes = 0;
+  uint64_t blocks = 0;
+  auto remaining = RemainingBytes(in);
+  bool read = ReadValue(in, &size) && ReadValue(in, &data_bytes)
+      && data_bytes <= remaining && data_bytes <= UINT32_MAX;
+  if (read) {
+    data_.resize(data_bytes);
+    read = static_cast<bool>(in.read(&data_[0], data_.size()))
+        && ReadValue(in, &blocks)
+        && blocks == size / kBlockSize + (size % kBlockSize != 0)
+        && blocks <= (remaining - data_bytes) / sizeof(uint32_t);
+  }
+  if (read) {
+    block_offsets_.resize(blocks);
+    read = static_cast<bool>(in.read(
+        reinterpret_cast<char*>(block_offsets_.data()),
+        block_offsets_.size() * sizeof(uint32_t)));
+  }
+  size_ = size;
+  if (!read || !Check()) {
+    data_.clear();
+    block_offsets_.clear();
+    size_ = 0;
+    in.setstate(std::ios::failbit);
+  }
+}
+
+void FrontCodedDictionary::Write(std::ostream& out) const {
+  WriteValue<uint64_t>(out, size_);
+  WriteValue<uint64_t>(out, data_.size());
+  out.write(data_.data(), data_.size());
+  WriteValue<uint64_t>(out, block_offsets_.size());
+  out.write(reinterpret_cast<const char*>(block_offsets_.data()),
+      block_offsets_.size() * sizeof(uint32_t));
+}
+
+bool FrontCodedDictionary::Find(const std::string& letters,
+    size_t* count) const {
+  // Find the last block whose first string is not after letters.
+  auto block = std::upper_bound(block_offsets_.begin(), block_offsets_.end(),
+      letters, [this](const std::string& letters, uint32_t offset) {
+        const char* in = data_.data() + offset;
+        auto length = GetVarint(&in);
+        return letters.compare(0, std::string::npos, in, length) < 0;
+      });
+  if (block == block_offsets_.begin()) {
+    return false;
+  }
+
+  bool found = false;
+  DecodeBlock(block - block_offsets_.begin() - 1,
+      [&letters, count, &found](const std::string& entry, size_t entry_count) {
+        if (entry < letters) {
+          return true;
+        }
+        if (entry == letters) {
+          *count = entry_count;
+          found = true;
+        }
+        return false;
+      });
+  return found;
+}
+
+void FrontCodedDictionary::ForEach(
+    const std::function<void(const std::string&, size_t)>& visit) const {
+  for (size_t block = 0; block < block_offsets_.size(); ++block) {
+    DecodeBlock(block, [&visit](const std::string& letters, size_t count) {
+      visit(letters, count);
+      return true;
+    });
+  }
+}
+
+bool FrontCodedDictionary::Check() const {
+  const char* in = data_.data();
+  const char* end = in;
+  for (size_t block = 0; block < block_offsets_.size(); ++block) {
+    // Blocks are end to end, so each one ends where the next one starts.
+    if (data_.data() + block_offsets_[block] != in) {
+      return false;
+    }
+    end = block + 1 < block_offsets_.size()
+        ? data_.data() + std::min<size_t>(block_offsets_[block + 1],
+            data_.size())
+        : data_.data() + data_.size();
+    auto entries = std::min(kBlockSize, size_ - block * kBlockSize);
+    uint64_t length = 0;
+    for (size_t i = 0; i < entries; ++i) {
+      uint64_t shared = 0;
+      uint64_t suffix = 0;
+      uint64_t count = 0;
+      if (i > 0 && !GetVarintChecked(&in, end, &shared)) {
+        return false;
+      }
+      if (shared > length || !GetVarintChecked(&in, end, &suffix)
+          || suffix > static_cast<uint64_t>(end - in)) {
+        return false;
+      }
+      in += suffix;
+      length = shared + suffix;
+      if (!GetVarintChecked(&in, end, &count)) {
+        return false;
+      }
+    }
+  }
+  return in == data_.data() + data_.size();
+}
+
+void FrontCodedDictionary::DecodeBlock(size_t block,
+    const std::function<bool(const std::string&, size_t)>& visit) const {
+  const char* in = data_.data() + block_offsets_[block];
+  auto entries = std::min(kBlockSize, size_ - block * kBlockSize);
+  std::string letters;
+  for (size_t i = 0; i < entries; ++i) {
+    if (i == 0) {
+      auto length = GetVarint(&in);
+      letters.assign(in, length);
+      in += length;
+    } else {
+      auto shared = GetVarint(&in);
+      auto suffix = GetVarint(&in);
+      letters.resize(shared);
+      letters.append(in, suffix);
+      in += suffix;
+    }
+    if (!visit(letters, GetVarint(&in))) {
+      return;
+    }
+  }
+}
+
+}  // namespace morfessor
@@ -0,0 +1,96 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "lexicon_diff.h"
+
+#include <algorithm>
+
+#include "morph.h"
+
+namespace morfessor {
+
+LexiconDiff::LexiconDiff(const Corpus& old_lexicon,
+    const Corpus& new_lexicon) {
+  // Model files start with a cost line, which reads as an empty morph.
+  // Skip it along with any other empty entries.
+  std::unordered_map<std::string, size_t> old_counts;
+  for (auto iter = old_lexicon.cbegin(); iter != old_lexicon.cend(); ++iter) {
+    if (!iter->letters().empty()) {
+      old_counts[iter->letters()] += iter->frequency();
+      old_total_ += iter->frequency();
+    }
+  }
+
+  std::unordered_map<std::string, size_t> new_counts;
+  for (auto iter = new_lexicon.cbegin(); iter != new_lexicon.cend(); ++iter) {
+    if (!iter->letters().empty()) {
+      new_counts[iter->letters()] += iter->frequency();
+      new_total_ += iter->frequency();
+    }
+  }
+
+  for (const auto& entry : new_counts) {
+    auto old_entry = old_counts.find(entry.first);
+    auto old_count = old_entry == old_counts.end() ? 0 : old_entry->second;
+    if (old_count != entry.second) {
+      changes_.emplace(entry.first, CountChange{old_count, entry.second});
+    } else {
+      unchanged_.emplace(entry.first, old_count);
+    }
+    if (entry.second > old_count) {
+      gained_.insert(entry.first);
+      max_gained_length_ = std::max(max_gained_length_, entry.first.length());
+    }
+  }
+
+  for (const auto& entry : old_counts) {
+    if (new_counts.find(entry.first) == new_counts.end()) {
+      changes_.emplace(entry.first, CountChange{entry.second, 0});
+    }
+  }
+}
+
+uint64_t LexiconChecksum(const Corpus& lexicon) {
+  // Each entry is hashed on its own and the hashes are added, so the order
+  // of the entries does not matter.
+  uint64_t checksum = 0;
+  for (auto iter = lexicon.cbegin(); iter != lexicon.cend(); ++iter) {
+    if (!iter->letters().empty()) {
+      checksum += LexiconEntryHash(iter->letters(), iter->frequency());
+    }
+  }
+  return checksum;
+}
+
+uint64_t LexiconEntryHash(const std::string& morph, size_t count) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (unsigned char c : morph) {
+    hash = (hash ^ c) * 0x100000001b3ULL;
+  }
+  hash ^= count * 0x9e3779b97f4a7c15ULL;
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+} // namespace morfessor
@@ -0,0 +1,200 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "line_scanner.h"
+
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace morfessor {
+
+namespace {
+
+inline bool is_blank(char c) noexcept {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+void ScanBlocksScalar(const char* text, size_t blocks, uint64_t* newlines,
+    uint64_t* blanks) noexcept {
+  for (size_t b = 0; b < blocks; ++b) {
+    uint64_t newline_bits = 0;
+    uint64_t blank_bits = 0;
+    for (unsigned i = 0; i < 64; ++i) {
+      auto c = text[64 * b + i];
+      newline_bits |= static_cast<uint64_t>(c == '\n') << i;
+      blank_bits |= static_cast<uint64_t>(is_blank(c)) << i;
+    }
+    newlines[b] = newline_bits;
+    blanks[b] = blank_bits;
+  }
+}
+
+#ifdef __SSE2__
+void ScanBlocksSse2(const char* text, size_t blocks, uint64_t* newlines,
+    uint64_t* blanks) noexcept {
+  // Tab, vertical tab, form feed and carriage return are 9 and 11 to 13,
+  // so all but the newline are in 9 to 13, which one signed compare finds
+  // after shifting 9 down to -128.
+  const auto newline = _mm_set1_epi8('\n');
+  const auto space = _mm_set1_epi8(' ');
+  const auto shift = _mm_set1_epi8(static_cast<char>(0x80 - '\t'));
+  const auto controls = _mm_set1_epi8(static_cast<char>(-128 + 5));
+  for (size_t b = 0; b < blocks; ++b) {
+    uint64_t newline_bits = 0;
+    uint64_t blank_bits = 0;
+    for (unsigned i = 0; i < 4; ++i) {
+      auto bytes = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(text + 64 * b + 16 * i));
+      auto is_newline = _mm_cmpeq_epi8(bytes, newline);
+      auto is_blank = _mm_or_si128(_mm_cmpeq_epi8(bytes, space),
+          _mm_andnot_si128(is_newline,
+              _mm_cmplt_epi8(_mm_add_epi8(bytes, shift), controls)));
+      newline_bits |= static_cast<uint64_t>(
+          static_cast<unsigned>(_mm_movemask_epi8(is_newline))) << (16 * i);
+      blank_bits |= static_cast<uint64_t>(
+          static_cast<unsigned>(_mm_movemask_epi8(is_blank))) << (16 * i);
+    }
+    newlines[b] = newline_bits;
+    blanks[b] = blank_bits;
+  }
+}
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2")))
+void ScanBlocksAvx2(const char* text, size_t blocks, uint64_t* newlines,
+    uint64_t* blanks) noexcept {
+  const auto newline = _mm256_set1_epi8('\n');
+  const auto space = _mm256_set1_epi8(' ');
+  const auto shift = _mm256_set1_epi8(static_cast<char>(0x80 - '\t'));
+  const auto controls = _mm256_set1_epi8(static_cast<char>(-128 + 5));
+  for (size_t b = 0; b < blocks; ++b) {
+    uint64_t newline_bits = 0;
+    uint64_t blank_bits = 0;
+    for (unsigned i = 0; i < 2; ++i) {
+      auto bytes = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(text + 64 * b + 32 * i));
+      auto is_newline = _mm256_cmpeq_epi8(bytes, newline);
+      // There is no signed less than, so the compare is turned around.
+      auto is_blank = _mm256_or_si256(_mm256_cmpeq_epi8(bytes, space),
+          _mm256_andnot_si256(is_newline, _mm256_cmpgt_epi8(controls,
+              _mm256_add_epi8(bytes, shift))));
+      newline_bits |= static_cast<uint64_t>(
+          static_cast<uint32_t>(_mm256_movemask_epi8(is_newline)))
+          << (32 * i);
+      blank_bits |= static_cast<uint64_t>(
+          static_cast<uint32_t>(_mm256_movemask_epi8(is_blank))) << (32 * i);
+    }
+    newlines[b] = newline_bits;
+    blanks[b] = blank_bits;
+  }
+}
+#endif
+
+/// Turns up to 8 digits, the first in the lowest byte and with leading
+/// zero digits in the bytes below it, into a number. Each step adds
+/// neighbouring pairs of numbers from the step before.
+inline uint64_t SwarDigits(uint64_t digits) noexcept {
+  digits = (digits * 10 + (digits >> 8)) & 0x00ff00ff00ff00ffULL;
+  digits = (digits * 100 + (digits >> 16)) & 0x0000ffff0000ffffULL;
+  return (digits * 10000 + (digits >> 32)) & 0xffffffffULL;
+}
+
+}  // namespace
+
+ScanLevel SupportedScanLevel() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+  static const ScanLevel level = __builtin_cpu_supports("avx2")
+      ? ScanLevel::kAvx2
+#ifdef __SSE2__
+      : ScanLevel::kSse2;
+#else
+      : ScanLevel::kScalar;
+#endif
+  return level;
+#else
+  return ScanLevel::kScalar;
+#endif
+}
+
+void ScanBlocks(const char* text, size_t blocks, uint64_t* newlines,
+    uint64_t* blanks, ScanLevel level) noexcept {
+  switch (level) {
+#if defined(__x86_64__) || defined(__i386__)
+    case ScanLevel::kAvx2:
+      ScanBlocksAvx2(text, blocks, newlines, blanks);
+      return;
+#endif
+#ifdef __SSE2__
+    case ScanLevel::kSse2:
+      ScanBlocksSse2(text, blocks, newlines, blanks);
+      return;
+#endif
+    default:
+      ScanBlocksScalar(text, blocks, newlines, blanks);
+  }
+}
+
+bool ParseCount(const char* text, size_t length, size_t* count) noexcept {
+  if (length == 0 || length > 19) {
+    return false;
+  }
+  if (length > 8) {
+    // Counts this large are rare enough for a plain loop.
+    uint64_t value = 0;
+    for (size_t i = 0; i < length; ++i) {
+      unsigned digit = static_cast<unsigned char>(text[i]) - '0';
+      if (digit > 9) {
+        return false;
+      }
+      value = value * 10 + digit;
+    }
+    *count = value;
+    return true;
+  }
+
+  uint64_t bytes;
+  std::memcpy(&bytes, text, 8);
+  // Only the first length bytes are the count. A byte is a digit if
+  // neither subtracting '0' nor adding 0x7f - '9' sets its top bit, and it
+  // did not have it set to begin with; a borrow or carry only reaches the
+  // bytes after it, which have been checked by then.
+  auto unused_bits = 64 - 8 * length;
+  auto mask = ~0ULL >> unused_bits;
+  auto not_digits = (bytes | (bytes - 0x3030303030303030ULL)
+      | (bytes + 0x4646464646464646ULL)) & 0x8080808080808080ULL & mask;
+  if (not_digits != 0) {
+    return false;
+  }
+  // Shifting the digits up fills the bytes below them with leading zeros.
+  *count = SwarDigits(((bytes - 0x3030303030303030ULL) & mask)
+      << unused_bits);
+  return true;
+}
+
+} // namespace morfessor
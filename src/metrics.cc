@@ -0,0 +1,218 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "metrics.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <utility>
+
+#include "resource_usage.h"
+
+namespace morfessor {
+
+namespace {
+
+/// Writes a number the way Prometheus expects, with enough digits to tell
+/// nearby counter values apart.
+void WriteValue(std::ostream& out, double value) {
+  if (value == std::numeric_limits<double>::infinity()) {
+    out << "+Inf";
+  } else {
+    auto precision = out.precision(17);
+    out << value;
+    out.precision(precision);
+  }
+}
+
+/// Writes a label value, escaping it as the text format requires.
+void WriteLabelValue(std::ostream& out, const std::string& value) {
+  for (auto c : value) {
+    if (c == '\\') {
+      out << "\\\\";
+    } else if (c == '"') {
+      out << "\\\"";
+    } else if (c == '\n') {
+      out << "\\n";
+    } else {
+      out << c;
+    }
+  }
+}
+
+} // namespace
+
+void Metrics::DefineCounter(const std::string& name,
+    const std::string& help) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  if (index_.emplace(name, metrics_.size()).second) {
+    metrics_.push_back(Metric{name, help, "counter"});
+  }
+}
+
+void Metrics::DefineGauge(const std::string& name, const std::string& help,
+    Labels labels) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  if (index_.emplace(name, metrics_.size()).second) {
+    metrics_.push_back(Metric{name, help, "gauge", std::move(labels)});
+  }
+}
+
+void Metrics::DefineHistogram(const std::string& name,
+    const std::string& help, std::vector<double> bounds) {
+  assert(std::is_sorted(bounds.begin(), bounds.end()));
+  std::lock_guard<std::mutex> lock{mutex_};
+  if (index_.emplace(name, metrics_.size()).second) {
+    Metric metric{name, help, "histogram"};
+    bounds.push_back(std::numeric_limits<double>::infinity());
+    metric.bucket_counts.assign(bounds.size(), 0);
+    metric.bounds = std::move(bounds);
+    metrics_.push_back(std::move(metric));
+  }
+}
+
+Metrics::Metric& Metrics::Find(const std::string& name) {
+  auto iter = index_.find(name);
+  assert(iter != index_.end());
+  return metrics_[iter->second];
+}
+
+void Metrics::Add(const std::string& name, double delta) {
+  assert(delta >= 0);
+  std::lock_guard<std::mutex> lock{mutex_};
+  Find(name).value += delta;
+}
+
+void Metrics::Set(const std::string& name, double value) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  Find(name).value = value;
+}
+
+void Metrics::Observe(const std::string& name, double value) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  auto& metric = Find(name);
+  auto bucket = std::lower_bound(metric.bounds.begin(), metric.bounds.end(),
+      value) - metric.bounds.begin();
+  ++metric.bucket_counts[bucket];
+  ++metric.count;
+  metric.value += value;
+}
+
+void Metrics::Write(std::ostream& out) const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  for (const auto& metric : metrics_) {
+    out << "# HELP " << metric.name << " " << metric.help << "\n";
+    out << "# TYPE " << metric.name << " " << metric.type << "\n";
+    if (metric.type != "histogram") {
+      out << metric.name;
+      if (!metric.labels.empty()) {
+        const char* separator = "{";
+        for (const auto& label : metric.labels) {
+          out << separator << label.first << "=\"";
+          WriteLabelValue(out, label.second);
+          out << "\"";
+          separator = ",";
+        }
+        out << "}";
+      }
+      out << " ";
+      WriteValue(out, metric.value);
+      out << "\n";
+      continue;
+    }
+
+    // Prometheus buckets are cumulative.
+    size_t cumulative = 0;
+    for (size_t i = 0; i < metric.bounds.size(); ++i) {
+      cumulative += metric.bucket_counts[i];
+      // Bounds are written as configured rather than at full precision.
+      out << metric.name << "_bucket{le=\"";
+      if (std::isinf(metric.bounds[i])) {
+        out << "+Inf";
+      } else {
+        out << metric.bounds[i];
+      }
+      out << "\"} " << cumulative << "\n";
+    }
+    out << metric.name << "_sum ";
+    WriteValue(out, metric.value);
+    out << "\n" << metric.name << "_count " << metric.count << "\n";
+  }
+}
+
+MetricsFile::MetricsFile(std::string path, Metrics* metrics,
+    std::chrono::milliseconds interval,
+    std::function<void(Metrics*)> update)
+    : path_{std::move(path)}, metrics_{metrics}, interval_{interval},
+      update_{std::move(update)} {
+  WriteOnce();
+  thread_ = std::thread{[this] {
+    std::unique_lock<std::mutex> lock{mutex_};
+    while (!stop_.wait_for(lock, interval_, [this] { return stopping_; })) {
+      WriteOnce();
+    }
+  }};
+}
+
+MetricsFile::~MetricsFile() {
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    stopping_ = true;
+  }
+  stop_.notify_one();
+  thread_.join();
+  WriteOnce();
+}
+
+void MetricsFile::WriteOnce() {
+  if (update_) {
+    update_(metrics_);
+  }
+  auto temporary = path_ + ".tmp";
+  {
+    std::ofstream out{temporary};
+    if (!out.is_open()) {
+      return;
+    }
+    metrics_->Write(out);
+  }
+  std::rename(temporary.c_str(), path_.c_str());
+}
+
+void UpdateMemoryMetrics(Metrics* metrics) {
+  metrics->DefineGauge("process_resident_memory_bytes",
+      "Resident memory size in bytes.");
+  metrics->DefineGauge("morfessor_peak_resident_memory_bytes",
+      "Largest resident memory size so far, in bytes.");
+  // The kernel updates the peak lazily, so it can trail the current size.
+  auto current = CurrentResidentBytes();
+  metrics->Set("process_resident_memory_bytes",
+      static_cast<double>(current));
+  metrics->Set("morfessor_peak_resident_memory_bytes",
+      static_cast<double>(std::max(current, PeakResidentBytes())));
+}
+
+} // namespace morfessor
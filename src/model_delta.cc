@@ -0,0 +1,131 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "model_delta.h"
+
+#include <algorithm>
+#include <cassert>
+#include <sstream>
+#include <unordered_map>
+
+#include "lexicon_diff.h"
+
+namespace morfessor {
+
+namespace {
+
+const char kHeader[] = "Model delta:";
+
+}  // namespace
+
+ModelDelta::ModelDelta(const Corpus& old_model, const Corpus& new_model)
+    : old_checksum_{LexiconChecksum(old_model)},
+      new_checksum_{LexiconChecksum(new_model)} {
+  LexiconDiff diff{old_model, new_model};
+  old_total_ = diff.old_total();
+  new_total_ = diff.new_total();
+  for (const auto& change : diff.changes()) {
+    changes_.push_back(Change{change.first, change.second.first,
+        change.second.second});
+  }
+  std::sort(changes_.begin(), changes_.end(),
+      [](const Change& a, const Change& b) { return a.morph < b.morph; });
+}
+
+ModelDelta::ModelDelta(std::istream& in) {
+  std::string line;
+  getline(in, line);
+  assert(line.compare(0, sizeof(kHeader) - 1, kHeader) == 0);
+  std::istringstream header{line.substr(sizeof(kHeader) - 1)};
+  header >> old_total_ >> new_total_ >> std::hex >> old_checksum_
+      >> new_checksum_;
+  assert(header);
+
+  while (getline(in, line)) {
+    std::istringstream fields{line};
+    Change change;
+    fields >> change.old_count >> change.new_count >> change.morph;
+    assert(fields && !change.morph.empty());
+    changes_.push_back(std::move(change));
+  }
+}
+
+void ModelDelta::Write(std::ostream& out) const {
+  out << kHeader << " " << old_total_ << " " << new_total_ << " "
+      << std::hex << old_checksum_ << " " << new_checksum_ << std::dec
+      << "\n";
+  for (const auto& change : changes_) {
+    out << change.old_count << " " << change.new_count << " "
+        << change.morph << "\n";
+  }
+}
+
+bool ModelDelta::Apply(const Corpus& old_model,
+    std::vector<Morph>* new_model) const {
+  if (LexiconChecksum(old_model) != old_checksum_) {
+    return false;
+  }
+  std::unordered_map<std::string, size_t> new_counts;
+  for (const auto& change : changes_) {
+    new_counts.emplace(change.morph, change.new_count);
+  }
+
+  // Keep the order of the old model, with the added morphs at the end.
+  new_model->clear();
+  new_model->reserve(old_model.size() + changes_.size());
+  for (auto iter = old_model.cbegin(); iter != old_model.cend(); ++iter) {
+    auto change = new_counts.find(iter->letters());
+    if (change == new_counts.end()) {
+      new_model->push_back(*iter);
+    } else if (change->second > 0) {
+      new_model->emplace_back(iter->letters(), change->second);
+      change->second = 0;
+    }
+  }
+  for (const auto& change : changes_) {
+    if (change.old_count == 0 && change.new_count > 0) {
+      new_model->emplace_back(change.morph, change.new_count);
+    }
+  }
+  return LexiconChecksum(Corpus{*new_model}) == new_checksum_;
+}
+
+bool ModelDelta::Apply(ViterbiLexicon* lexicon) const {
+  auto checksum = [lexicon] {
+    uint64_t sum = 0;
+    lexicon->ForEach([&sum](const std::string& morph, size_t count) {
+      sum += LexiconEntryHash(morph, count);
+    });
+    return sum;
+  };
+  if (lexicon->total_morph_tokens() != old_total_
+      || checksum() != old_checksum_) {
+    return false;
+  }
+  for (const auto& change : changes_) {
+    lexicon->SetCount(change.morph, change.new_count);
+  }
+  lexicon->SetTotal(new_total_);
+  return checksum() == new_checksum_;
+}
+
+} // namespace morfessor
@@ -0,0 +1,255 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "model_server.h"
+
+#include <cassert>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <utility>
+
+#include "bounded_queue.h"
+
+namespace morfessor {
+
+namespace {
+
+/// Requests answered together, as in the --load pipeline.
+constexpr size_t kBatchLines = 4096;
+constexpr size_t kQueueBatches = 16;
+
+using Lines = std::vector<std::string>;
+
+/// A batch of requests and where its answers go.
+struct Job {
+  Lines lines;
+  std::promise<Lines> answers;
+};
+
+} // namespace
+
+ModelServer::ModelServer(size_t threads) : threads_{threads} {
+  assert(threads > 0);
+}
+
+void ModelServer::AddModel(const std::string& name,
+    std::unique_ptr<Segmentation> segmentation, size_t resident_bytes) {
+  assert(index_.find(name) == index_.end());
+  index_.emplace(name, models_.size());
+  models_.emplace_back(new Served);
+  auto& served = *models_.back();
+  served.name = name;
+  served.segmentation = std::move(segmentation);
+  served.resident_bytes = resident_bytes;
+}
+
+void ModelServer::Serve(std::istream& in, std::ostream& out) {
+  assert(!models_.empty());
+  // The answers are queued in the order of the requests, so the writer can
+  // wait for each batch in turn while the workers finish them in any order.
+  BoundedQueue<Job> jobs{kQueueBatches};
+  BoundedQueue<std::future<Lines>> answers{kQueueBatches};
+
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < threads_; ++i) {
+    workers.emplace_back([this, &jobs] {
+      Job job;
+      while (jobs.Pop(&job)) {
+        Answer(&job.lines);
+        job.answers.set_value(std::move(job.lines));
+      }
+    });
+  }
+  std::thread writer{[&answers, &out] {
+    std::future<Lines> batch;
+    while (answers.Pop(&batch)) {
+      for (const auto& line : batch.get()) {
+        out << line << "\n";
+      }
+      out.flush();
+    }
+  }};
+
+  // Reading from a stream tied to the output would flush it on this thread
+  // while the writer writes to it.
+  auto tied = in.tie(nullptr);
+  Lines lines;
+  std::string line;
+  auto submit = [&] {
+    Job job;
+    job.lines = std::move(lines);
+    auto answered = job.answers.get_future();
+    jobs.Push(std::move(job));
+    answers.Push(std::move(answered));
+    lines = Lines{};
+    lines.reserve(kBatchLines);
+  };
+  // A batch also ends where the input has nothing more buffered, so that a
+  // client that waits for its answers before it writes more gets them.
+  while (getline(in, line)) {
+    lines.push_back(std::move(line));
+    if (lines.size() == kBatchLines || in.rdbuf()->in_avail() <= 0) {
+      submit();
+    }
+  }
+  if (!lines.empty()) {
+    submit();
+  }
+  jobs.Close();
+  answers.Close();
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  writer.join();
+  in.tie(tied);
+}
+
+void ModelServer::Answer(Lines* lines) {
+  // Which lines go to which model, and the words they ask for.
+  std::vector<std::vector<size_t>> positions(models_.size());
+  std::vector<Lines> words(models_.size());
+  for (size_t i = 0; i < lines->size(); ++i) {
+    auto& line = (*lines)[i];
+    auto tab = line.find('\t');
+    size_t model = 0;
+    if (tab != std::string::npos) {
+      auto found = index_.find(line.substr(0, tab));
+      if (found == index_.end()) {
+        ++unknown_requests_;
+        line.clear();
+        continue;
+      }
+      model = found->second;
+      line.erase(0, tab + 1);
+    }
+    positions[model].push_back(i);
+    words[model].push_back(std::move(line));
+  }
+
+  for (size_t model = 0; model < models_.size(); ++model) {
+    if (words[model].empty()) {
+      continue;
+    }
+    Segment(models_[model].get(), &words[model]);
+    for (size_t j = 0; j < positions[model].size(); ++j) {
+      (*lines)[positions[model][j]] = std::move(words[model][j]);
+    }
+  }
+}
+
+void ModelServer::ServeRing(SharedRing* ring) {
+  assert(!models_.empty());
+  std::vector<std::vector<uint32_t>> sequences(models_.size());
+  std::vector<Lines> words(models_.size());
+  std::vector<std::vector<size_t>> morph_lengths;
+  uint32_t answered = 0;
+  for (;;) {
+    auto requested = ring->WaitForRequests(answered);
+    if (requested == answered) {
+      return;
+    }
+    for (auto sequence = answered; sequence != requested; ++sequence) {
+      auto& slot = ring->slot(sequence);
+      // The client writes the slot, so its fields are read once and checked
+      // before the word is.
+      auto model = slot.model;
+      auto length = slot.length;
+      if (model >= models_.size()) {
+        ++unknown_requests_;
+        slot.morphs = 0;
+        continue;
+      }
+      if (length > SharedRing::kMaxWordBytes) {
+        ++malformed_requests_;
+        slot.morphs = 0;
+        continue;
+      }
+      sequences[model].push_back(sequence);
+      words[model].emplace_back(slot.word, length);
+    }
+
+    for (size_t model = 0; model < models_.size(); ++model) {
+      if (words[model].empty()) {
+        continue;
+      }
+      Split(models_[model].get(), words[model], &morph_lengths);
+      // Every morph has at least one byte, so the ends of a word that fits
+      // in a slot fit in it too.
+      for (size_t j = 0; j < sequences[model].size(); ++j) {
+        auto& slot = ring->slot(sequences[model][j]);
+        const auto& lengths = morph_lengths[j];
+        assert(lengths.size() <= SharedRing::kMaxWordBytes);
+        size_t end = 0;
+        for (size_t morph = 0; morph < lengths.size(); ++morph) {
+          end += lengths[morph];
+          slot.ends[morph] = static_cast<uint8_t>(end);
+        }
+        slot.morphs = static_cast<uint8_t>(lengths.size());
+      }
+      sequences[model].clear();
+      words[model].clear();
+    }
+    ring->PublishAnswers(requested);
+    answered = requested;
+  }
+}
+
+void ModelServer::Segment(Served* served, Lines* words) {
+  auto start = std::chrono::steady_clock::now();
+  served->segmentation->SegmentBatch(words);
+  served->segment_nanoseconds +=
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - start).count();
+  served->words += words->size();
+}
+
+void ModelServer::Split(Served* served, const Lines& words,
+    std::vector<std::vector<size_t>>* morph_lengths) {
+  auto start = std::chrono::steady_clock::now();
+  served->segmentation->SplitBatch(words, morph_lengths);
+  served->segment_nanoseconds +=
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - start).count();
+  served->words += words.size();
+}
+
+std::vector<std::string> ModelServer::names() const {
+  std::vector<std::string> names;
+  for (const auto& served : models_) {
+    names.push_back(served->name);
+  }
+  return names;
+}
+
+ServedModelStats ModelServer::stats(const std::string& name) const {
+  const auto& served = *models_[index_.at(name)];
+  ServedModelStats stats;
+  stats.morphs = served.segmentation->frozen_size();
+  stats.lexicon_bytes = served.segmentation->frozen_bytes();
+  stats.resident_bytes = served.resident_bytes;
+  stats.words = served.words;
+  stats.segment_seconds = served.segment_nanoseconds * 1e-9;
+  return stats;
+}
+
+} // namespace morfessor
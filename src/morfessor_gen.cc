@@ -0,0 +1,191 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Generates synthetic word lists in the "count word" format read by Corpus.
+// Words are built by concatenating morphs drawn from a random inventory with
+// Zipfian probabilities, and word counts follow a Zipf law over the order in
+// which the words were generated. The true segmentation of every word can be
+// written out in the format of the Morpho Challenge gold standard, so a model
+// trained on the output can be scored with morpho-challenge-eval.perl.
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <gflags/gflags.h>
+
+DEFINE_uint64(types, 100000, "number of distinct words to generate");
+DEFINE_double(zipf, 1.0, "Zipf exponent for word counts and morph choice");
+DEFINE_uint64(max_count, 1000000, "count of the most frequent word");
+DEFINE_uint64(morphs, 20000, "size of the morph inventory");
+DEFINE_double(mean_morphs, 2.5, "mean number of morphs per word "
+    "(geometric distribution starting at 1)");
+DEFINE_uint64(max_morphs, 8, "maximum number of morphs per word");
+DEFINE_uint64(min_morph_length, 1, "shortest morph in the inventory");
+DEFINE_uint64(max_morph_length, 8, "longest morph in the inventory");
+DEFINE_string(alphabet, "abcdefghijklmnopqrstuvwxyz", "single-byte letters "
+    "to build morphs from");
+DEFINE_uint64(seed, 1, "seed for the random number generator");
+DEFINE_string(gold, "", "file to write the true segmentation to");
+
+static bool ValidatePositive(const char* flagname, uint64_t value) {
+  return value > 0;
+}
+
+static bool ValidateExponent(const char* flagname, double value) {
+  return value >= 0;
+}
+
+static bool ValidateMeanMorphs(const char* flagname, double value) {
+  return value >= 1;
+}
+
+static bool ValidateAlphabet(const char* flagname, const std::string& value) {
+  return !value.empty()
+      && value.find_first_of(" \t\n") == std::string::npos;
+}
+
+/// Makes a set of distinct random morphs. Morph lengths are uniformly
+/// distributed between the given bounds.
+static std::vector<std::string> MakeInventory(std::mt19937_64& rng) {
+  std::uniform_int_distribution<size_t> length(FLAGS_min_morph_length,
+      FLAGS_max_morph_length);
+  std::uniform_int_distribution<size_t> letter(0, FLAGS_alphabet.size() - 1);
+
+  std::vector<std::string> inventory;
+  std::unordered_set<std::string> seen;
+  inventory.reserve(FLAGS_morphs);
+  size_t failures = 0;
+  while (inventory.size() < FLAGS_morphs) {
+    std::string morph(length(rng), ' ');
+    for (auto& c : morph) {
+      c = FLAGS_alphabet[letter(rng)];
+    }
+    if (seen.insert(morph).second) {
+      inventory.push_back(morph);
+      failures = 0;
+    } else if (++failures > 10000) {
+      std::cerr << "Cannot make " << FLAGS_morphs << " distinct morphs from "
+          "this alphabet and length range" << std::endl;
+      std::exit(1);
+    }
+  }
+  return inventory;
+}
+
+int main(int argc, char** argv)
+{
+  gflags::RegisterFlagValidator(&FLAGS_types, &ValidatePositive);
+  gflags::RegisterFlagValidator(&FLAGS_max_count, &ValidatePositive);
+  gflags::RegisterFlagValidator(&FLAGS_morphs, &ValidatePositive);
+  gflags::RegisterFlagValidator(&FLAGS_max_morphs, &ValidatePositive);
+  gflags::RegisterFlagValidator(&FLAGS_min_morph_length, &ValidatePositive);
+  gflags::RegisterFlagValidator(&FLAGS_max_morph_length, &ValidatePositive);
+  gflags::RegisterFlagValidator(&FLAGS_zipf, &ValidateExponent);
+  gflags::RegisterFlagValidator(&FLAGS_mean_morphs, &ValidateMeanMorphs);
+  gflags::RegisterFlagValidator(&FLAGS_alphabet, &ValidateAlphabet);
+
+  google::ParseCommandLineFlags(&argc, &argv, true);
+
+  if (FLAGS_min_morph_length > FLAGS_max_morph_length) {
+    std::cerr << "min_morph_length is larger than max_morph_length"
+        << std::endl;
+    return 1;
+  }
+
+  std::mt19937_64 rng(FLAGS_seed);
+  auto inventory = MakeInventory(rng);
+
+  // Morph ranks follow the same Zipf law as the words.
+  std::vector<double> weights(inventory.size());
+  for (size_t rank = 0; rank < weights.size(); ++rank) {
+    weights[rank] = std::pow(rank + 1, -FLAGS_zipf);
+  }
+  std::discrete_distribution<size_t> pick_morph(weights.begin(),
+      weights.end());
+  // A geometric distribution needs p < 1, so a mean of one morph, where
+  // every word is a single morph, does not draw from it.
+  bool single_morphs = FLAGS_mean_morphs == 1;
+  std::geometric_distribution<size_t> extra_morphs(
+      single_morphs ? 0.5 : 1.0 / FLAGS_mean_morphs);
+
+  std::ofstream gold;
+  if (!FLAGS_gold.empty()) {
+    gold.open(FLAGS_gold);
+    if (!gold.is_open()) {
+      std::cerr << "Cannot open " << FLAGS_gold << std::endl;
+      return 1;
+    }
+  }
+
+  // Only hashes of the words are kept to detect duplicates, which keeps the
+  // memory needed for very large lists down to a few words per type. A hash
+  // collision merely causes a fresh word to be drawn instead.
+  std::unordered_set<uint64_t> seen;
+  seen.reserve(FLAGS_types);
+  std::hash<std::string> hash;
+
+  std::ios::sync_with_stdio(false);
+  std::string word;
+  std::string analysis;
+  size_t failures = 0;
+  for (uint64_t rank = 1; rank <= FLAGS_types; ) {
+    auto num_morphs = single_morphs ? 1 : std::min<size_t>(
+        1 + extra_morphs(rng), FLAGS_max_morphs);
+    word.clear();
+    analysis.clear();
+    for (size_t i = 0; i < num_morphs; ++i) {
+      const auto& morph = inventory[pick_morph(rng)];
+      word += morph;
+      if (i > 0) {
+        analysis += ' ';
+      }
+      analysis += morph;
+    }
+
+    if (!seen.insert(hash(word)).second) {
+      if (++failures > 100000) {
+        std::cerr << "Stopped after " << rank - 1 << " words: the inventory "
+            "is too small for more distinct words" << std::endl;
+        return 1;
+      }
+      continue;
+    }
+    failures = 0;
+
+    auto count = std::max<uint64_t>(1, std::llround(
+        FLAGS_max_count * std::pow(rank, -FLAGS_zipf)));
+    std::cout << count << ' ' << word << '\n';
+    if (gold.is_open()) {
+      gold << word << '\t' << analysis << '\n';
+    }
+    ++rank;
+  }
+
+  return 0;
+}
@@ -20,28 +20,98 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include <signal.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <csignal>
+#include <iomanip>
 #include <iostream>
 #include <fstream>
 #include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include <gflags/gflags.h>
 
+#include "boundary_statistics.h"
+#include "bounded_queue.h"
 #include "corpus.h"
+#include "lexicon_diff.h"
+#include "metrics.h"
 #include "model.h"
+#include "model_delta.h"
+#include "model_server.h"
+#include "resource_usage.h"
 #include "segmentation.h"
+#include "segmentation_cache.h"
+#include "shared_ring.h"
+#include "word_counter.h"
 
 using Corpus = morfessor::Corpus;
 using Segmentation = morfessor::Segmentation;
 using AlgorithmModes = morfessor::AlgorithmModes;
 using Model = morfessor::Model;
+using Seconds = std::chrono::duration<double>;
+using WordBatch = std::vector<std::string>;
+using WordBatchQueue = morfessor::BoundedQueue<WordBatch>;
+
+/// Words per batch handed between pipeline stages, and batches each queue
+/// holds. Large enough that locking is rare, small enough that the stages
+/// start overlapping right away.
+constexpr size_t kBatchWords = 4096;
+constexpr size_t kQueueBatches = 16;
 
 DEFINE_string(mode, "Baseline", "algorithm version to use "
     "(Baseline, Freq, Length, FreqLength)");
 DEFINE_string(data, "", "word list to segment");
 DEFINE_string(load, "", "pre-segmented word list to use as model");
+DEFINE_string(model_format, "text", "format of the trained model written "
+    "to stdout: text, or front_coded for a smaller binary file that --load "
+    "and --previous read as well");
+DEFINE_string(text, "", "raw text to segment in place with the loaded model "
+    "(use - for stdin)");
+DEFINE_string(separator, "+", "string inserted between morphs when "
+    "segmenting raw text");
+DEFINE_string(train_text, "", "raw text to count words in and train on "
+    "instead of a --data word list; must be a file, not a pipe");
+DEFINE_uint64(sketch_width, 0, "counters per row of the count-min sketch "
+    "used to count --train_text words approximately in fixed memory. "
+    "0 counts every word exactly");
+DEFINE_uint64(sketch_depth, 4, "rows of the count-min sketch");
+DEFINE_uint64(heavy_hitters, 65536, "number of frequent --train_text words "
+    "whose counts are kept exactly when using the sketch");
+DEFINE_string(previous, "", "model that --cache was segmented with; only "
+    "words affected by changes since then are segmented again");
+DEFINE_string(cache, "", "segmentation of the --data word list made with "
+    "the --previous model");
+DEFINE_string(delta, "", "file to write the words whose segmentation "
+    "changed relative to --cache to");
+DEFINE_string(write_model_delta, "", "file to write the changes from the "
+    "--previous model to the --load model to, instead of segmenting");
+DEFINE_string(apply_model_delta, "", "changes written by "
+    "--write_model_delta to make to the --load model before segmenting");
+DEFINE_string(models, "", "comma separated name=path list of models to "
+    "load into one process that segments the words on stdin, one per line "
+    "after the name of its model and a tab");
+DEFINE_string(ring, "", "with --models, take words from a client through a "
+    "ring in shared memory created at this path, such as /dev/shm/morfessor, "
+    "instead of from stdin");
+DEFINE_uint64(serve_threads, 0, "threads shared by the --models; 0 uses "
+    "one per core");
+DEFINE_string(heldout, "", "word list to score: with --load alone, print "
+    "its code length in nats under the model; while training, score it "
+    "after every epoch");
+DEFINE_uint64(heldout_patience, 0, "stop training once the --heldout "
+    "score has not improved for this many epochs; 0 only reports it");
+DEFINE_uint64(score_threads, 0, "threads to score --heldout on; 0 uses "
+    "one per core");
 DEFINE_double(hapax, 0.5, "prior probability for "
     "proportion of morphs that only appear once. Must be in range (0,1)");
 DEFINE_double(finish, 0.005, "threshold for when to stop trying to improve"
@@ -49,6 +119,45 @@ DEFINE_double(finish, 0.005, "threshold for when to stop trying to improve"
 DEFINE_double(most_common_length, 7, "most common morph length");
 DEFINE_double(beta, 1.0, "beta value for morph length Gamma "
     "distribution");
+DEFINE_uint64(memory_budget_mb, 0, "approximate memory for lexicon nodes "
+    "while training; colder nodes are spilled to disk. 0 means no limit");
+DEFINE_string(spill_file, "morfessor.spill", "file for nodes spilled by "
+    "--memory_budget_mb");
+DEFINE_int64(seed, -1, "seed for shuffling the words while training, so "
+    "that a run can be repeated. -1 picks a random seed");
+DEFINE_uint64(threads, 0, "threads for training in deterministic batches: "
+    "the result depends on --seed and --batch_words but not on the number "
+    "of threads. 0 trains one word at a time");
+DEFINE_uint64(batch_words, 1024, "words resplit in parallel against the "
+    "same state when --threads is set");
+DEFINE_uint64(hot_morphs, 65536, "most frequent morphs kept in a small "
+    "array that stays in cache when segmenting with --load. The same hash "
+    "table finds hot and cold morphs, so a lookup probes it once either way");
+DEFINE_uint64(steps_per_nat, 1, "resolution of the 16 bit morph costs "
+    "used when segmenting with --load. 1 keeps whole nats, as training "
+    "does; more steps keep part of the fraction and change some splits");
+DEFINE_bool(batch_probes, true, "when segmenting with --load, look up the "
+    "substrings of several words together with prefetching, so that cache "
+    "misses overlap; false looks them up one at a time");
+DEFINE_uint64(train_min_count, 0, "train only on words that occur at least "
+    "this often; rarer words are split with the trained morphs afterwards "
+    "and added to the model. 0 trains on every word");
+DEFINE_bool(seed_splits, false, "split the training words at likely morph "
+    "boundaries, found from the branching entropy of shared prefixes and "
+    "suffixes, before optimizing");
+DEFINE_double(seed_threshold, 1.0, "lowest boundary score (entropy after "
+    "the prefix plus entropy before the suffix, in nats) at which "
+    "--seed_splits splits a word");
+DEFINE_uint64(seed_min_types, 5, "prefixes and suffixes shared by fewer "
+    "word types than this are ignored by --seed_splits");
+DEFINE_string(metrics_file, "", "file to keep rewriting with segmentation "
+    "metrics in Prometheus text format, for a textfile collector to scrape");
+DEFINE_uint64(metrics_interval_ms, 1000, "how often to rewrite "
+    "--metrics_file");
+DEFINE_string(live_stats_file, "", "file to append a snapshot of training "
+    "progress to whenever the process gets SIGUSR1; stderr if empty");
+DEFINE_bool(stats, false, "print training time, epochs, peak memory and "
+    "lexicon size (or segmentation counts) to stderr");
 
 static bool ValidateProportion(const char* flagname, double value) {
   return value > 0 && value < 1;
@@ -59,7 +168,43 @@ static bool ValidateLoad(const char* flagname, const std::string& path) {
 }
 
 static bool ValidateData(const char* flagname, const std::string& path) {
-  return access(path.c_str(), F_OK) != -1;
+  return path == "" || access(path.c_str(), F_OK) != -1;
+}
+
+static bool ValidateText(const char* flagname, const std::string& path) {
+  return path == "" || path == "-" || access(path.c_str(), F_OK) != -1;
+}
+
+/// Splits --models into its names and paths.
+static std::vector<std::pair<std::string, std::string>> ParseModels(
+    const std::string& models) {
+  std::vector<std::pair<std::string, std::string>> parsed;
+  std::stringstream list{models};
+  std::string entry;
+  while (getline(list, entry, ',')) {
+    auto equals = entry.find('=');
+    if (equals == std::string::npos) {
+      return {};
+    }
+    parsed.emplace_back(entry.substr(0, equals), entry.substr(equals + 1));
+  }
+  return parsed;
+}
+
+static bool ValidateModels(const char* flagname,
+    const std::string& models) {
+  if (models.empty()) {
+    return true;
+  }
+  auto parsed = ParseModels(models);
+  std::unordered_set<std::string> names;
+  for (const auto& name_path : parsed) {
+    if (name_path.first.empty() || !names.insert(name_path.first).second
+        || access(name_path.second.c_str(), F_OK) == -1) {
+      return false;
+    }
+  }
+  return !parsed.empty();
 }
 
 static bool ValidateMode(const char* flagname, const std::string& mode) {
@@ -67,6 +212,11 @@ static bool ValidateMode(const char* flagname, const std::string& mode) {
       mode == "FreqLength";
 }
 
+static bool ValidateModelFormat(const char* flagname,
+    const std::string& format) {
+  return format == "text" || format == "front_coded";
+}
+
 static bool ValidateBeta(const char* flagname, double beta) {
   return beta > 0;
 }
@@ -75,53 +225,657 @@ static bool ValidateLength(const char* flagname, double length) {
   return length > 0 && length < 24*FLAGS_beta;
 }
 
+/// Set by SIGUSR1 to ask for a snapshot of training progress.
+static volatile std::sig_atomic_t live_stats_requested = 0;
+
+static void RequestLiveStats(int) {
+  live_stats_requested = 1;
+}
+
+/// Writes the progress of training and the state of the model as one line
+/// of key=value pairs.
+static void WriteLiveStats(const morfessor::OptimizeProgress& progress,
+    const Model& model) {
+  std::ostringstream line;
+  line.precision(10);
+  line << "epoch=" << progress.epoch
+      << " position=" << progress.position << "/" << progress.words
+      << " overall_cost=" << model.overall_cost()
+      << " lexicon_cost=" << model.lexicon_cost()
+      << " corpus_cost=" << model.corpus_cost()
+      << " frequency_cost=" << model.frequency_cost()
+      << " length_cost=" << model.length_cost()
+      << " morph_string_cost=" << model.morph_string_cost()
+      << " lexicon_order_cost=" << model.lexicon_order_cost()
+      << " lexicon_size=" << model.unique_morph_types()
+      << " rss_kb=" << morfessor::CurrentResidentBytes() / 1024
+      << " peak_rss_kb=" << morfessor::PeakResidentBytes() / 1024
+      << " words_per_second=" << (progress.epoch_seconds > 0
+          ? progress.position / progress.epoch_seconds : 0)
+      << " seconds=" << progress.total_seconds << "\n";
+
+  if (FLAGS_live_stats_file.empty()) {
+    std::cerr << line.str() << std::flush;
+  } else {
+    std::ofstream file{FLAGS_live_stats_file, std::ios::app};
+    file << line.str();
+  }
+}
+
+/// Defines the metrics written while segmenting with a loaded model.
+static void DefineSegmentationMetrics(morfessor::Metrics* metrics,
+    const Corpus& lexicon, const Model& model) {
+  metrics->DefineCounter("morfessor_requests_total",
+      "Batches of words segmented.");
+  metrics->DefineCounter("morfessor_words_total", "Words segmented.");
+  metrics->DefineHistogram("morfessor_batch_latency_seconds",
+      "Time to segment one batch of words.",
+      {0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1,
+          2.5});
+  metrics->DefineCounter("morfessor_cache_lookups_total",
+      "Words looked up in the segmentation cache.");
+  metrics->DefineCounter("morfessor_cache_hits_total",
+      "Words whose cached segmentation was still valid.");
+  metrics->DefineGauge("morfessor_lexicon_size", "Morphs in the model.");
+  metrics->Set("morfessor_lexicon_size", model.unique_morph_types());
+
+  // The checksum identifies the model version whatever its file is called.
+  std::ostringstream checksum;
+  checksum << std::hex << morfessor::LexiconChecksum(lexicon);
+  metrics->DefineGauge("morfessor_model_info", "The loaded model.",
+      {{"path", FLAGS_load}, {"checksum", checksum.str()}});
+  metrics->Set("morfessor_model_info", 1);
+  morfessor::UpdateMemoryMetrics(metrics);
+}
+
+/// First pipeline stage: parses the word list and queues its words.
+static void ReadWordList(const std::string& path, WordBatchQueue* words,
+    double* busy_seconds) {
+  auto start = std::chrono::steady_clock::now();
+  Seconds waiting{0};
+  std::ifstream file{path, std::ios::binary};
+  assert(file.is_open());
+  WordBatch batch;
+  Corpus::ParseStream(file, [&](std::vector<morfessor::Morph>* lines) {
+    for (const auto& line : *lines) {
+      batch.push_back(line.letters());
+      if (batch.size() == kBatchWords) {
+        auto push_start = std::chrono::steady_clock::now();
+        words->Push(std::move(batch));
+        waiting += std::chrono::steady_clock::now() - push_start;
+        batch = WordBatch{};
+        batch.reserve(kBatchWords);
+      }
+    }
+  });
+  if (!batch.empty()) {
+    words->Push(std::move(batch));
+  }
+  words->Close();
+  *busy_seconds = Seconds(std::chrono::steady_clock::now() - start).count()
+      - waiting.count();
+}
+
+/// Last pipeline stage: writes the queued lines to stdout.
+static void WriteLines(WordBatchQueue* lines, double* busy_seconds) {
+  Seconds busy{0};
+  WordBatch batch;
+  while (lines->Pop(&batch)) {
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& line : batch) {
+      std::cout << line << "\n";
+    }
+    busy += std::chrono::steady_clock::now() - start;
+  }
+  std::cout.flush();
+  *busy_seconds = busy.count();
+}
+
+/// Makes the model for the algorithm chosen by --mode.
+static std::shared_ptr<Model> MakeModel(const Corpus& corpus) {
+  if (FLAGS_mode == "FreqLength") {
+    return std::make_shared<morfessor::BaselineFrequencyLengthModel>(corpus,
+        FLAGS_hapax, FLAGS_most_common_length, FLAGS_beta);
+  } else if (FLAGS_mode == "Freq") {
+    return std::make_shared<morfessor::BaselineFrequencyModel>(corpus,
+        FLAGS_hapax);
+  } else if (FLAGS_mode == "Length") {
+    return std::make_shared<morfessor::BaselineLengthModel>(corpus,
+        FLAGS_most_common_length, FLAGS_beta);
+  }
+  return std::make_shared<morfessor::BaselineModel>(corpus);
+}
+
+/// Loads every model in --models and answers requests on stdin until it
+/// ends.
+static void ServeModels() {
+  morfessor::ModelServer server{FLAGS_serve_threads > 0 ? FLAGS_serve_threads
+      : std::max(1u, std::thread::hardware_concurrency())};
+  for (const auto& name_path : ParseModels(FLAGS_models)) {
+    // The corpus and the nodes are dropped before measuring, so only what
+    // the model keeps counts.
+    morfessor::ReleaseFreeMemory();
+    auto resident_before = morfessor::CurrentResidentBytes();
+    std::unique_ptr<Segmentation> segmentation;
+    {
+      Corpus lexicon{name_path.second};
+      segmentation = std::make_unique<Segmentation>(lexicon,
+          MakeModel(lexicon));
+    }
+    segmentation->Freeze(FLAGS_hot_morphs, FLAGS_steps_per_nat);
+    segmentation->ReleaseNodes();
+    segmentation->set_batch_probes(FLAGS_batch_probes);
+    morfessor::ReleaseFreeMemory();
+    auto resident_after = morfessor::CurrentResidentBytes();
+    server.AddModel(name_path.first, std::move(segmentation),
+        resident_after > resident_before
+            ? resident_after - resident_before : 0);
+  }
+
+  if (!FLAGS_ring.empty()) {
+    morfessor::SharedRing ring{FLAGS_ring, true, server.names()};
+    server.ServeRing(&ring);
+  } else {
+    std::ios::sync_with_stdio(false);
+    server.Serve(std::cin, std::cout);
+  }
+
+  if (FLAGS_stats) {
+    for (const auto& name : server.names()) {
+      auto stats = server.stats(name);
+      std::cerr << "model=" << name
+          << " morphs=" << stats.morphs
+          << " lexicon_kb=" << stats.lexicon_bytes / 1024
+          << " resident_kb=" << stats.resident_bytes / 1024
+          << " words=" << stats.words
+          << " segment_seconds=" << stats.segment_seconds << std::endl;
+    }
+    std::cerr << "unknown_requests=" << server.unknown_requests()
+        << " malformed_requests=" << server.malformed_requests()
+        << " peak_rss_kb=" << morfessor::PeakResidentBytes() / 1024
+        << std::endl;
+  }
+}
+
+/// Returns the threads to score --heldout on.
+static size_t ScoreThreads() {
+  return FLAGS_score_threads > 0 ? FLAGS_score_threads
+      : std::max(1u, std::thread::hardware_concurrency());
+}
+
+/// Prints the code length of --heldout under the --load model.
+static void ScoreHeldout() {
+  Corpus heldout{FLAGS_heldout};
+  Corpus lexicon{FLAGS_load};
+  Segmentation st(lexicon, MakeModel(lexicon));
+  auto score_start = std::chrono::steady_clock::now();
+  auto cost = st.Score(heldout, ScoreThreads());
+  auto score_seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - score_start).count();
+
+  size_t tokens = 0;
+  for (auto iter = heldout.cbegin(); iter != heldout.cend(); ++iter) {
+    tokens += iter->frequency();
+  }
+  std::cout << "heldout_cost=" << std::setprecision(15) << cost
+      << " word_types=" << heldout.size()
+      << " word_tokens=" << tokens
+      << " nats_per_token=" << (tokens > 0 ? cost / tokens : 0)
+      << std::endl;
+  if (FLAGS_stats) {
+    std::cerr << "score_seconds=" << score_seconds << std::endl;
+  }
+}
+
+/// Makes the changes in --apply_model_delta to a segmentation of the
+/// --load model, and complains if they were made from a different model.
+static bool ApplyModelDelta(Segmentation* st) {
+  std::ifstream in{FLAGS_apply_model_delta};
+  morfessor::ModelDelta delta{in};
+  if (!st->ApplyDelta(delta)) {
+    std::cerr << "--apply_model_delta was not made from the --load model"
+        << std::endl;
+    return false;
+  }
+  return true;
+}
+
 int main(int argc, char** argv)
 {
   gflags::RegisterFlagValidator(&FLAGS_hapax, &ValidateProportion);
   gflags::RegisterFlagValidator(&FLAGS_finish, &ValidateProportion);
   gflags::RegisterFlagValidator(&FLAGS_data, &ValidateData);
   gflags::RegisterFlagValidator(&FLAGS_load, &ValidateLoad);
+  gflags::RegisterFlagValidator(&FLAGS_text, &ValidateText);
+  gflags::RegisterFlagValidator(&FLAGS_train_text, &ValidateData);
+  gflags::RegisterFlagValidator(&FLAGS_heldout, &ValidateData);
+  gflags::RegisterFlagValidator(&FLAGS_previous, &ValidateLoad);
+  gflags::RegisterFlagValidator(&FLAGS_cache, &ValidateLoad);
+  gflags::RegisterFlagValidator(&FLAGS_apply_model_delta, &ValidateLoad);
+  gflags::RegisterFlagValidator(&FLAGS_models, &ValidateModels);
   gflags::RegisterFlagValidator(&FLAGS_mode, &ValidateMode);
+  gflags::RegisterFlagValidator(&FLAGS_model_format, &ValidateModelFormat);
   gflags::RegisterFlagValidator(&FLAGS_most_common_length, &ValidateLength);
   gflags::RegisterFlagValidator(&FLAGS_beta, &ValidateBeta);
 
   google::ParseCommandLineFlags(&argc, &argv, true);
 
+  if (!FLAGS_write_model_delta.empty()) {
+    if (FLAGS_load.empty() || FLAGS_previous.empty()) {
+      std::cerr << "--write_model_delta requires both --load and --previous"
+          << std::endl;
+      return 1;
+    }
+    morfessor::ModelDelta delta{Corpus{FLAGS_previous}, Corpus{FLAGS_load}};
+    std::ofstream out{FLAGS_write_model_delta};
+    delta.Write(out);
+    if (FLAGS_stats) {
+      std::cerr << "changed_morphs=" << delta.changes().size()
+          << " old_total=" << delta.old_total()
+          << " new_total=" << delta.new_total() << std::endl;
+    }
+    return 0;
+  }
+
+  if (!FLAGS_models.empty()) {
+    if (!FLAGS_data.empty() || !FLAGS_load.empty()
+        || !FLAGS_train_text.empty()) {
+      std::cerr << "--models cannot be combined with --data, --load or "
+          "--train_text" << std::endl;
+      return 1;
+    }
+    if (!FLAGS_ring.empty()) {
+      auto models = ParseModels(FLAGS_models);
+      bool fits = models.size() <= morfessor::SharedRing::kMaxModels;
+      for (const auto& name_path : models) {
+        fits = fits && name_path.first.size()
+            <= morfessor::SharedRing::kMaxNameBytes;
+      }
+      if (!fits) {
+        std::cerr << "--ring serves at most "
+            << morfessor::SharedRing::kMaxModels << " --models with names "
+            "of at most " << morfessor::SharedRing::kMaxNameBytes
+            << " bytes" << std::endl;
+        return 1;
+      }
+    }
+    ServeModels();
+    return 0;
+  }
+
+  if (!FLAGS_heldout.empty() && !FLAGS_load.empty()) {
+    if (!FLAGS_data.empty() || !FLAGS_text.empty()) {
+      std::cerr << "--heldout with --load cannot be combined with --data or "
+          "--text" << std::endl;
+      return 1;
+    }
+    ScoreHeldout();
+    return 0;
+  }
+
+  if (!FLAGS_heldout.empty() && FLAGS_memory_budget_mb > 0) {
+    std::cerr << "--heldout cannot be combined with --memory_budget_mb"
+        << std::endl;
+    return 1;
+  }
+
+  if (FLAGS_data.empty() && FLAGS_train_text.empty()
+      && (FLAGS_load.empty() || FLAGS_text.empty())) {
+    std::cerr << "--data is required unless training on --train_text or "
+        "segmenting --text with a model given by --load" << std::endl;
+    return 1;
+  }
+
+  if (!FLAGS_train_text.empty()
+      && (!FLAGS_data.empty() || !FLAGS_load.empty())) {
+    std::cerr << "--train_text cannot be combined with --data or --load"
+        << std::endl;
+    return 1;
+  }
+
+  if (!FLAGS_cache.empty()
+      && (FLAGS_load.empty() || FLAGS_previous.empty())) {
+    std::cerr << "--cache requires both --load and --previous" << std::endl;
+    return 1;
+  }
+
+  if (!FLAGS_apply_model_delta.empty()
+      && (FLAGS_load.empty() || !FLAGS_cache.empty())) {
+    std::cerr << "--apply_model_delta requires --load and cannot be "
+        "combined with --cache" << std::endl;
+    return 1;
+  }
+
+  if (FLAGS_steps_per_nat == 0 || FLAGS_steps_per_nat > 1024) {
+    std::cerr << "--steps_per_nat must be between 1 and 1024" << std::endl;
+    return 1;
+  }
+
+  if (FLAGS_threads > 0
+      && (FLAGS_memory_budget_mb > 0 || FLAGS_batch_words == 0)) {
+    std::cerr << "--threads needs a nonzero --batch_words and cannot be "
+        "combined with --memory_budget_mb" << std::endl;
+    return 1;
+  }
+
+  auto start_time = std::chrono::steady_clock::now();
+
+  // Plain segmentation of a word list with a loaded model runs as a
+  // pipeline: the word list is parsed while the model is built, and lines
+  // are written while later words are still being segmented.
+  bool pipelined = !FLAGS_load.empty() && FLAGS_text.empty()
+      && FLAGS_cache.empty();
+  WordBatchQueue word_batches{kQueueBatches};
+  std::thread reader;
+  double parse_seconds = 0;
+  if (pipelined) {
+    std::ios::sync_with_stdio(false);
+    reader = std::thread{ReadWordList, FLAGS_data, &word_batches,
+        &parse_seconds};
+  }
+
   std::shared_ptr<Corpus> corpus = nullptr;
   std::shared_ptr<Model> model = nullptr;
 
-  if (FLAGS_load.empty()) {
+  if (!FLAGS_train_text.empty()) {
+    morfessor::WordCountOptions options;
+    options.sketch_width = FLAGS_sketch_width;
+    options.sketch_depth = std::max<uint64_t>(FLAGS_sketch_depth, 1);
+    options.heavy_hitters = FLAGS_heavy_hitters;
+    morfessor::WordCountStats count_stats;
+    corpus = std::make_shared<Corpus>(morfessor::CountWords(FLAGS_train_text,
+        options, &count_stats));
+    if (FLAGS_stats) {
+      std::cerr << "tokens=" << count_stats.tokens
+          << " exact_words=" << count_stats.heavy_words
+          << " sketch_words=" << count_stats.tail_words
+          << " counting_bytes=" << count_stats.counting_bytes
+          << " count_error_bound=" << count_stats.error_bound << std::endl;
+    }
+  } else if (FLAGS_load.empty()) {
     corpus = std::make_shared<Corpus>(FLAGS_data);
   } else {
     corpus = std::make_shared<Corpus>(FLAGS_load);
   }
 
-  // Set algorithm parameters
-  if (FLAGS_mode == "FreqLength") {
-    model = std::make_shared<morfessor::BaselineModel>(*corpus);
-  } else if (FLAGS_mode == "Freq") {
-    model = std::make_shared<morfessor::BaselineFrequencyModel>(*corpus,
-        FLAGS_hapax);
-  } else if (FLAGS_mode == "Length") {
-    model = std::make_shared<morfessor::BaselineLengthModel>(*corpus,
-        FLAGS_most_common_length, FLAGS_beta);
-  } else {
-    model = std::make_shared<morfessor::BaselineFrequencyLengthModel>(*corpus,
-        FLAGS_hapax, FLAGS_most_common_length, FLAGS_beta);
+  model = MakeModel(*corpus);
+
+  morfessor::Metrics metrics;
+  std::unique_ptr<morfessor::MetricsFile> metrics_file;
+  if (!FLAGS_metrics_file.empty() && !FLAGS_load.empty()) {
+    DefineSegmentationMetrics(&metrics, *corpus, *model);
+    metrics_file.reset(new morfessor::MetricsFile(FLAGS_metrics_file,
+        &metrics, std::chrono::milliseconds(FLAGS_metrics_interval_ms),
+        morfessor::UpdateMemoryMetrics));
   }
 
   if (FLAGS_load.empty()) {
+    std::unique_ptr<Segmentation> segmentation;
+    if (FLAGS_memory_budget_mb > 0) {
+      // Rough size of a resident node: the map entry with its key, the two
+      // child keys and the hash bucket pointing at it.
+      constexpr size_t kNodeBytes = 160;
+      segmentation = std::make_unique<Segmentation>(*corpus, model,
+          FLAGS_spill_file, std::max<size_t>(1,
+              FLAGS_memory_budget_mb * 1024 * 1024 / kNodeBytes));
+    } else {
+      segmentation = std::make_unique<Segmentation>(*corpus, model);
+    }
+    Segmentation& st = *segmentation;
+    if (FLAGS_seed >= 0) {
+      st.set_seed(static_cast<unsigned>(FLAGS_seed));
+    }
+    st.set_threads(FLAGS_threads, FLAGS_batch_words);
+    std::unique_ptr<Corpus> heldout;
+    if (!FLAGS_heldout.empty()) {
+      heldout.reset(new Corpus(FLAGS_heldout));
+      st.set_heldout(heldout.get(), FLAGS_heldout_patience, ScoreThreads());
+    }
+
+    // The handler only sets a flag; Optimize notices it before the next
+    // word and writes the snapshot from the main thread.
+    struct sigaction action = {};
+    action.sa_handler = RequestLiveStats;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGUSR1, &action, nullptr);
+    st.set_progress_request(&live_stats_requested,
+        [&model](const morfessor::OptimizeProgress& progress) {
+          WriteLiveStats(progress, *model);
+        });
+
+    auto train_start = std::chrono::steady_clock::now();
+
+    // Rare words are left out of training. The model took its letter
+    // probabilities from every word, so they still count there.
+    std::shared_ptr<Corpus> training = corpus;
+    std::unique_ptr<Corpus> deferred;
+    if (FLAGS_train_min_count > 1) {
+      // Only --seed_splits reads the training words back; without it the
+      // segmentation itself is all that is left to train on.
+      std::vector<morfessor::Morph> frequent;
+      std::vector<morfessor::Morph> rare;
+      for (auto iter = corpus->cbegin(); iter != corpus->cend(); ++iter) {
+        if (iter->frequency() < FLAGS_train_min_count) {
+          rare.push_back(*iter);
+        } else if (FLAGS_seed_splits) {
+          frequent.push_back(*iter);
+        }
+      }
+      if (FLAGS_seed_splits) {
+        training = std::make_shared<Corpus>(std::move(frequent));
+      }
+      deferred.reset(new Corpus(std::move(rare)));
+      st.RemoveWords(*deferred);
+    }
+
+    size_t seeded_words = 0;
+    double seed_seconds = 0;
+    if (FLAGS_seed_splits) {
+      morfessor::BoundaryStatistics statistics{*training,
+          FLAGS_seed_min_types};
+      seeded_words = st.SeedSplits(*training, statistics,
+          FLAGS_seed_threshold);
+      seed_seconds = std::chrono::duration<double>(
+          std::chrono::steady_clock::now() - train_start).count();
+      st.Optimize(*training);
+    } else {
+      st.Optimize();
+    }
+
+    size_t deferred_words = 0;
+    double deferred_seconds = 0;
+    if (deferred) {
+      auto deferred_start = std::chrono::steady_clock::now();
+      deferred_words = st.AddViterbiSplits(*deferred);
+      deferred_seconds = std::chrono::duration<double>(
+          std::chrono::steady_clock::now() - deferred_start).count();
+    }
+    if (FLAGS_stats) {
+      double seconds = std::chrono::duration<double>(
+          std::chrono::steady_clock::now() - train_start).count();
+      auto epochs = st.epoch_seconds().size();
+      std::cerr << "word_types=" << corpus->size()
+          << " epochs=" << epochs
+          << " train_seconds=" << seconds
+          << " seconds_per_epoch=" << (epochs > 0 ? seconds / epochs : 0)
+          << " peak_rss_kb=" << morfessor::PeakResidentBytes() / 1024
+          << " lexicon_size=" << model->unique_morph_types()
+          << " overall_cost=" << model->overall_cost();
+      if (FLAGS_seed_splits) {
+        std::cerr << " seeded_words=" << seeded_words
+            << " seed_seconds=" << seed_seconds;
+      }
+      if (heldout) {
+        // Optimize runs at least one epoch, so there is a score.
+        const auto& costs = st.heldout_costs();
+        auto best = std::min_element(costs.begin(), costs.end());
+        std::cerr << " heldout_cost=" << costs.back()
+            << " best_heldout_cost=" << *best
+            << " best_heldout_epoch=" << (best - costs.begin()) + 1;
+      }
+      if (deferred) {
+        std::cerr << " deferred_words=" << deferred_words
+            << " deferred_seconds=" << deferred_seconds;
+      }
+      if (auto spill = st.spill_stats()) {
+        std::cerr << " spill_evictions=" << spill->evictions
+            << " spill_page_ins=" << spill->page_ins
+            << " spill_bytes_written=" << spill->bytes_written
+            << " spill_bytes_read=" << spill->bytes_read
+            << " spill_compactions=" << spill->compactions;
+      }
+      std::cerr << std::endl;
+    }
+    // The dot file and the model are written at the same time. Reading
+    // spilled nodes moves the spill file's read position, so with spilling
+    // they are written one after the other.
+    std::thread dot_writer{[&st] {
+      auto out = std::ofstream("output.dot");
+      st.print_dot(out);
+    }};
+    if (st.spill_stats() != nullptr) {
+      dot_writer.join();
+    }
+    if (FLAGS_model_format == "front_coded") {
+      st.print_front_coded(std::cout);
+    } else {
+      std::cout << st;
+    }
+    if (dot_writer.joinable()) {
+      dot_writer.join();
+    }
+  } else if (!FLAGS_text.empty()) {
     Segmentation st(*corpus, model);
-    st.Optimize();
-    auto out = std::ofstream("output.dot");
-    st.print_dot(out);
-    std::cout << st;
-  } else {
+    if (!FLAGS_apply_model_delta.empty() && !ApplyModelDelta(&st)) {
+      return 1;
+    }
+    st.Freeze(FLAGS_hot_morphs, FLAGS_steps_per_nat);
+    st.set_batch_probes(FLAGS_batch_probes);
+    std::ios::sync_with_stdio(false);
+    if (FLAGS_text == "-") {
+      st.SegmentText(std::cin, std::cout, FLAGS_separator);
+    } else {
+      std::ifstream text{FLAGS_text, std::ios::binary};
+      st.SegmentText(text, std::cout, FLAGS_separator);
+    }
+  } else if (!FLAGS_cache.empty()) {
     Segmentation st(*corpus, model);
+    st.Freeze(FLAGS_hot_morphs, FLAGS_steps_per_nat);
+    st.set_batch_probes(FLAGS_batch_probes);
     Corpus test_corpus{FLAGS_data};
-    auto segments = st.SegmentTestCorpus(test_corpus);
-    for (auto word_splits : *segments) {
-      std::cout << word_splits << std::endl;
+    morfessor::SegmentationCache cache{FLAGS_cache};
+    morfessor::LexiconDiff diff{Corpus{FLAGS_previous}, *corpus};
+    auto stale = cache.Invalidate(diff, FLAGS_steps_per_nat);
+    auto segment_start = std::chrono::steady_clock::now();
+    auto segments = st.SegmentTestCorpus(test_corpus, cache);
+    if (metrics_file) {
+      size_t hits = 0;
+      for (auto iter = test_corpus.cbegin(); iter != test_corpus.cend();
+          ++iter) {
+        hits += cache.find(iter->letters()) != nullptr;
+      }
+      metrics.Add("morfessor_requests_total", 1);
+      metrics.Add("morfessor_words_total", test_corpus.size());
+      metrics.Add("morfessor_cache_lookups_total", test_corpus.size());
+      metrics.Add("morfessor_cache_hits_total", hits);
+      metrics.Observe("morfessor_batch_latency_seconds",
+          Seconds(std::chrono::steady_clock::now() - segment_start).count());
+    }
+
+    // The delta lists new words (+), words whose segmentation changed (~)
+    // and cached words that are no longer in the word list (-).
+    std::ofstream delta;
+    if (!FLAGS_delta.empty()) {
+      delta.open(FLAGS_delta);
+    }
+    std::unordered_set<std::string> seen;
+    size_t changed = 0;
+    auto segment = segments->cbegin();
+    for (auto iter = test_corpus.cbegin(); iter != test_corpus.cend();
+        ++iter, ++segment) {
+      std::cout << *segment << "\n";
+      seen.insert(iter->letters());
+      auto previous = cache.previous(iter->letters());
+      if (previous == nullptr || *previous != *segment) {
+        ++changed;
+        if (delta.is_open()) {
+          delta << (previous == nullptr ? "+ " : "~ ") << iter->letters()
+              << "\t" << *segment << std::endl;
+        }
+      }
+    }
+    if (delta.is_open()) {
+      for (const auto& word : cache.words()) {
+        if (seen.find(word) == seen.end()) {
+          delta << "- " << word << std::endl;
+        }
+      }
+    }
+
+    if (FLAGS_stats) {
+      std::cerr << "word_types=" << test_corpus.size()
+          << " cached=" << cache.size()
+          << " changed_morphs=" << diff.changes().size()
+          << " stale=" << stale
+          << " changed_segmentations=" << changed << std::endl;
+    }
+  } else {
+    Segmentation st(*corpus, model);
+    st.Freeze(FLAGS_hot_morphs, FLAGS_steps_per_nat);
+    st.set_batch_probes(FLAGS_batch_probes);
+    if (!FLAGS_apply_model_delta.empty() && !ApplyModelDelta(&st)) {
+      WordBatch batch;
+      while (word_batches.Pop(&batch)) {
+      }
+      reader.join();
+      return 1;
+    }
+    auto model_seconds = Seconds(std::chrono::steady_clock::now()
+        - start_time).count();
+
+    WordBatchQueue line_batches{kQueueBatches};
+    double write_seconds = 0;
+    std::thread writer{WriteLines, &line_batches, &write_seconds};
+    Seconds segment_busy{0};
+    WordBatch batch;
+    while (word_batches.Pop(&batch)) {
+      auto segment_start = std::chrono::steady_clock::now();
+      st.SegmentBatch(&batch);
+      auto latency = std::chrono::steady_clock::now() - segment_start;
+      segment_busy += latency;
+      if (metrics_file) {
+        metrics.Add("morfessor_requests_total", 1);
+        metrics.Add("morfessor_words_total", batch.size());
+        metrics.Observe("morfessor_batch_latency_seconds",
+            Seconds(latency).count());
+      }
+      line_batches.Push(std::move(batch));
+      batch = WordBatch{};
+    }
+    line_batches.Close();
+    writer.join();
+    reader.join();
+
+    if (FLAGS_stats) {
+      std::cerr << "parse_seconds=" << parse_seconds
+          << " model_seconds=" << model_seconds
+          << " segment_seconds=" << segment_busy.count()
+          << " write_seconds=" << write_seconds
+          << " wall_seconds=" << Seconds(std::chrono::steady_clock::now()
+              - start_time).count();
+      // The cold ratio is over the lookups the hot array did not answer.
+      auto lookups = st.lexicon_stats();
+      auto total = lookups.hot_hits + lookups.cold_hits + lookups.misses;
+      auto cold = lookups.cold_hits + lookups.misses;
+      std::cerr << " lexicon_lookups=" << total
+          << " hot_hits=" << lookups.hot_hits
+          << " cold_hits=" << lookups.cold_hits
+          << " hot_hit_ratio="
+          << (total > 0 ? static_cast<double>(lookups.hot_hits) / total : 0)
+          << " cold_hit_ratio="
+          << (cold > 0 ? static_cast<double>(lookups.cold_hits) / cold : 0)
+          << std::endl;
     }
   }
 
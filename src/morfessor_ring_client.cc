@@ -0,0 +1,246 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Sends the words of a word list to a morfessor --models server and reads
+// the answers back, a few words per round trip, either through the shared
+// memory ring of --ring or through the stdin and stdout of the server
+// process. Reports the time per round trip, so the two transports can be
+// compared, and can print the segmentations in the format of --load.
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gflags/gflags.h>
+
+#include "shared_ring.h"
+
+DEFINE_string(ring, "", "path of the ring a morfessor --models --ring "
+    "server created");
+DEFINE_string(server, "", "shell command that starts a morfessor --models "
+    "server to talk to through its stdin and stdout, instead of --ring");
+DEFINE_string(data, "", "word list in the \"count word\" format of "
+    "morfessor --data");
+DEFINE_string(model, "", "name of the model to segment the words with; "
+    "empty means the first one");
+DEFINE_uint64(in_flight, 1, "words sent in each round trip");
+DEFINE_uint64(repeats, 1, "times to send the word list");
+DEFINE_bool(print, false, "write the segmentations to stdout");
+
+using Clock = std::chrono::steady_clock;
+
+/// Waits for a new ring to appear, since the server makes it only after it
+/// has loaded its models.
+static void WaitForRing(const std::string& path) {
+  while (access(path.c_str(), F_OK) == -1) {
+    usleep(10000);
+  }
+}
+
+/// A server process whose stdin and stdout are pipes.
+class ServerProcess {
+ public:
+  explicit ServerProcess(const std::string& command) {
+    int requests[2];
+    int answers[2];
+    if (pipe(requests) != 0 || pipe(answers) != 0) {
+      assert(false);
+    }
+    pid_ = fork();
+    assert(pid_ != -1);
+    if (pid_ == 0) {
+      dup2(requests[0], 0);
+      dup2(answers[1], 1);
+      close(requests[1]);
+      close(answers[0]);
+      execl("/bin/sh", "sh", "-c", command.c_str(),
+          static_cast<char*>(nullptr));
+      _exit(127);
+    }
+    close(requests[0]);
+    close(answers[1]);
+    to_server_ = fdopen(requests[1], "w");
+    from_server_ = fdopen(answers[0], "r");
+  }
+
+  ~ServerProcess() {
+    std::fclose(to_server_);
+    std::fclose(from_server_);
+    waitpid(pid_, nullptr, 0);
+  }
+
+  void Write(const std::string& line) {
+    std::fwrite(line.data(), 1, line.size(), to_server_);
+  }
+
+  void Flush() { std::fflush(to_server_); }
+
+  std::string ReadLine() {
+    std::string line;
+    int c;
+    while ((c = std::fgetc(from_server_)) != EOF && c != '\n') {
+      line += static_cast<char>(c);
+    }
+    return line;
+  }
+
+ private:
+  pid_t pid_;
+  FILE* to_server_;
+  FILE* from_server_;
+};
+
+int main(int argc, char** argv)
+{
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  if (FLAGS_ring.empty() == FLAGS_server.empty() || FLAGS_data.empty()
+      || FLAGS_in_flight == 0
+      || FLAGS_in_flight > morfessor::SharedRing::kSlots) {
+    std::cerr << "Give --data and one of --ring and --server, and an "
+        "--in_flight between 1 and " << morfessor::SharedRing::kSlots
+        << std::endl;
+    return 1;
+  }
+
+  // Words too long for a slot are left out of both transports alike.
+  std::vector<std::string> words;
+  std::ifstream data{FLAGS_data};
+  std::string line;
+  while (getline(data, line)) {
+    std::istringstream fields{line};
+    size_t count;
+    std::string word;
+    if (fields >> count >> word
+        && word.size() <= morfessor::SharedRing::kMaxWordBytes) {
+      words.push_back(word);
+    }
+  }
+
+  std::unique_ptr<morfessor::RingClient> ring;
+  std::unique_ptr<ServerProcess> server;
+  int model = 0;
+  if (!FLAGS_ring.empty()) {
+    WaitForRing(FLAGS_ring);
+    ring.reset(new morfessor::RingClient{FLAGS_ring});
+    if (!FLAGS_model.empty()) {
+      model = ring->model(FLAGS_model);
+      if (model < 0) {
+        std::cerr << "The server has no model called " << FLAGS_model
+            << std::endl;
+        return 1;
+      }
+    }
+  } else {
+    server.reset(new ServerProcess{FLAGS_server});
+  }
+  std::string prefix = FLAGS_model.empty() ? "" : FLAGS_model + "\t";
+
+  // One word that is not timed waits for a server that is still loading.
+  if (!words.empty()) {
+    size_t morphs;
+    if (ring) {
+      ring->Push(model, words[0].data(), words[0].size());
+      ring->Flush();
+      ring->Pop(&morphs);
+    } else {
+      server->Write(prefix + words[0] + "\n");
+      server->Flush();
+      server->ReadLine();
+    }
+  }
+
+  std::vector<double> round_trips;
+  std::string answer;
+  auto start = Clock::now();
+  for (size_t repeat = 0; repeat < FLAGS_repeats; ++repeat) {
+    for (size_t first = 0; first < words.size(); first += FLAGS_in_flight) {
+      auto last = std::min(words.size(), first + FLAGS_in_flight);
+      auto sent = Clock::now();
+      for (auto i = first; i < last; ++i) {
+        if (ring) {
+          ring->Push(model, words[i].data(), words[i].size());
+        } else {
+          server->Write(prefix + words[i] + "\n");
+        }
+      }
+      if (ring) {
+        ring->Flush();
+      } else {
+        server->Flush();
+      }
+      for (auto i = first; i < last; ++i) {
+        if (ring) {
+          size_t morphs;
+          auto ends = ring->Pop(&morphs);
+          if (FLAGS_print) {
+            answer.clear();
+            size_t begin = 0;
+            for (size_t m = 0; m < morphs; ++m) {
+              answer.append(words[i], begin, ends[m] - begin);
+              answer += ' ';
+              begin = ends[m];
+            }
+          }
+        } else {
+          answer = server->ReadLine();
+        }
+        if (FLAGS_print && repeat == 0) {
+          std::cout << answer << "\n";
+        }
+      }
+      round_trips.push_back(
+          std::chrono::duration<double, std::micro>(Clock::now() - sent)
+              .count());
+    }
+  }
+  double seconds = std::chrono::duration<double>(Clock::now() - start)
+      .count();
+  ring.reset();
+  server.reset();
+
+  std::sort(round_trips.begin(), round_trips.end());
+  auto percentile = [&round_trips](double p) {
+    return round_trips.empty() ? 0
+        : round_trips[static_cast<size_t>(p * (round_trips.size() - 1))];
+  };
+  auto total_words = words.size() * FLAGS_repeats;
+  std::cerr << "transport=" << (FLAGS_ring.empty() ? "stream" : "ring")
+      << " words=" << total_words
+      << " round_trips=" << round_trips.size()
+      << " seconds=" << seconds
+      << " us_per_word=" << (total_words > 0 ? seconds * 1e6 / total_words
+          : 0)
+      << " p50_us=" << percentile(0.5)
+      << " p99_us=" << percentile(0.99) << std::endl;
+  return 0;
+}
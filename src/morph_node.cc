@@ -28,6 +28,6 @@ MorphNode::MorphNode()
     : MorphNode(0) {}
 
 MorphNode::MorphNode(size_t count)
-    : count{count}, left_child{}, right_child{} {}
+    : count{count}, left_child{}, right_child{}, last_touched{0} {}
 
 } // namespace morfessor
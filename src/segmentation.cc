@@ -22,28 +22,258 @@
 
 #include "segmentation.h"
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cstring>
 #include <iostream>
 #include <iomanip>
+#include <limits>
 #include <random>
+#include <thread>
 #include <fstream>
+#include <functional>
+#include <tuple>
+#include <unordered_set>
 #include <vector>
 #include <memory>
 
+#include "boundary_statistics.h"
+#include "bounded_queue.h"
 #include "corpus.h"
+#include "front_coded_dictionary.h"
+#include "lexicon_diff.h"
 #include "morph.h"
+#include "tokenizer.h"
 
 namespace morfessor {
 
+namespace {
+
+/// Resplits words against a segmentation that it only reads, keeping the
+/// nodes it changes and its own copy of the model on the side, so that
+/// several trials can share one segmentation from different threads. Each
+/// word starts again from the shared state, which is read again for every
+/// word, so one trial can be used for many batches. The choices are made
+/// the same way as in Segmentation::ResplitNode.
+class ResplitTrial {
+ public:
+  ResplitTrial(const std::unordered_map<std::string, MorphNode>& nodes,
+      const Model& model)
+      : nodes_(nodes), snapshot_(model), model_(model) {}
+
+  /// Returns the split position chosen for the word and then for each part
+  /// resplit recursively, in the order ResplitNode visits them, with zero
+  /// for a part left whole.
+  std::vector<size_t> Resplit(const std::string& word) {
+    overlay_.clear();
+    model_ = snapshot_;
+    split_indices_.clear();
+    ResplitNode(word);
+    return split_indices_;
+  }
+
+ private:
+  /// Returns the node for a morph as this trial has changed it; a node with
+  /// a zero count does not exist.
+  MorphNode& Node(const std::string& morph) {
+    auto iter = overlay_.find(morph);
+    if (iter == overlay_.end()) {
+      auto shared = nodes_.find(morph);
+      iter = overlay_.emplace(morph, shared != nodes_.end() ?
+          shared->second : MorphNode()).first;
+    }
+    return iter->second;
+  }
+
+  void AdjustMorphCount(const std::string& morph, int delta) {
+    MorphNode& subtree = Node(morph);
+    assert(delta >= 0 || static_cast<size_t>(-delta) <= subtree.count);
+    auto old_count = subtree.count;
+    auto new_count = subtree.count + delta;
+    auto left_child = subtree.left_child;
+    auto right_child = subtree.right_child;
+    if (new_count == 0) {
+      subtree = MorphNode();
+    } else {
+      subtree.count = new_count;
+    }
+
+    if (!left_child.empty()) {
+      AdjustMorphCount(left_child, delta);
+      AdjustMorphCount(right_child, delta);
+    } else {
+      model_.adjust_morph_token_count(delta);
+      if (old_count > 0) {
+        model_.adjust_corpus_cost(-old_count);
+        model_.adjust_frequency_cost(-old_count);
+      }
+      if (new_count > 0) {
+        model_.adjust_corpus_cost(new_count);
+        model_.adjust_frequency_cost(new_count);
+      }
+      if (old_count == 0 && new_count > 0) {
+        model_.adjust_unique_morph_count(1);
+        model_.adjust_length_cost(morph.length());
+        model_.adjust_string_cost(morph, true);
+      } else if (new_count == 0 && old_count > 0) {
+        model_.adjust_unique_morph_count(-1);
+        model_.adjust_length_cost(-morph.length());
+        model_.adjust_string_cost(morph, false);
+      }
+    }
+  }
+
+  void ResplitNode(const std::string& morph) {
+    auto frequency = Node(morph).count;
+    AdjustMorphCount(morph, -frequency);
+    AdjustMorphCount(morph, frequency);
+    auto best_cost = model_.overall_cost();
+    size_t best_split_index = 0;
+    AdjustMorphCount(morph, -frequency);
+    for (size_t split_index = 1; split_index < morph.size(); ++split_index) {
+      auto left_child = morph.substr(0, split_index);
+      auto right_child = morph.substr(split_index);
+      AdjustMorphCount(left_child, frequency);
+      AdjustMorphCount(right_child, frequency);
+      auto new_cost = model_.overall_cost();
+      if (new_cost < best_cost) {
+        best_cost = new_cost;
+        best_split_index = split_index;
+      }
+      AdjustMorphCount(left_child, -frequency);
+      AdjustMorphCount(right_child, -frequency);
+    }
+
+    split_indices_.push_back(best_split_index);
+    if (best_split_index > 0) {
+      auto left_child = morph.substr(0, best_split_index);
+      auto right_child = morph.substr(best_split_index);
+      MorphNode& parent = Node(morph);
+      parent.count = frequency;
+      parent.left_child = left_child;
+      parent.right_child = right_child;
+      AdjustMorphCount(left_child, frequency);
+      AdjustMorphCount(right_child, frequency);
+      ResplitNode(left_child);
+      ResplitNode(right_child);
+    } else {
+      AdjustMorphCount(morph, frequency);
+    }
+  }
+
+  const std::unordered_map<std::string, MorphNode>& nodes_;
+  const Model& snapshot_;
+  Model model_;
+  std::unordered_map<std::string, MorphNode> overlay_;
+  std::vector<size_t> split_indices_;
+};
+
+} // namespace
+
+/// The threads ResplitBatch deals words out to, each with its own
+/// ResplitTrial, made once for a whole Optimize call.
+class Segmentation::ResplitWorkers {
+ public:
+  ResplitWorkers(const std::unordered_map<std::string, MorphNode>& nodes,
+      const Model& model, size_t threads)
+      : threads_{std::max<size_t>(threads, 1)},
+        tasks_{threads_}, done_{threads_} {
+    trials_.reserve(threads_);
+    for (size_t thread = 0; thread < threads_; ++thread) {
+      trials_.emplace_back(nodes, model);
+    }
+    for (size_t thread = 1; thread < threads_; ++thread) {
+      workers_.emplace_back([this, thread] {
+        Task task;
+        while (tasks_.Pop(&task)) {
+          Run(task, &trials_[thread]);
+          done_.Push(thread);
+        }
+      });
+    }
+  }
+
+  ~ResplitWorkers() {
+    tasks_.Close();
+    for (auto& worker : workers_) {
+      worker.join();
+    }
+  }
+
+  /// Resplits keys[begin, end) against the shared state, and stores the
+  /// choices for keys[i] in (*split_indices)[i - begin]. The shared state
+  /// must not change until this returns.
+  void Resplit(const std::vector<std::string>& keys, size_t begin,
+      size_t end, std::vector<std::vector<size_t>>* split_indices) {
+    // Words are dealt out to the threads by position, and every trial
+    // starts from the same state, so the choices do not depend on the
+    // thread count.
+    size_t pushed = 0;
+    for (size_t first = 1; first < threads_ && begin + first < end;
+        ++first) {
+      tasks_.Push(Task{&keys, begin, end, first, split_indices});
+      ++pushed;
+    }
+    Run(Task{&keys, begin, end, 0, split_indices}, &trials_[0]);
+    for (; pushed > 0; --pushed) {
+      size_t thread;
+      done_.Pop(&thread);
+    }
+  }
+
+ private:
+  /// Every threads_-th word of a batch, starting at first.
+  struct Task {
+    const std::vector<std::string>* keys;
+    size_t begin;
+    size_t end;
+    size_t first;
+    std::vector<std::vector<size_t>>* split_indices;
+  };
+
+  void Run(const Task& task, ResplitTrial* trial) {
+    for (auto i = task.begin + task.first; i < task.end; i += threads_) {
+      (*task.split_indices)[i - task.begin] = trial->Resplit((*task.keys)[i]);
+    }
+  }
+
+  size_t threads_;
+  std::vector<ResplitTrial> trials_;
+  BoundedQueue<Task> tasks_;
+  BoundedQueue<size_t> done_;
+  std::vector<std::thread> workers_;
+};
+
+constexpr size_t Segmentation::kViterbiLanes;
+constexpr size_t Segmentation::kLongestUnfrozenLaneWord;
+constexpr size_t Segmentation::kTextBatchWords;
+
 Segmentation::Segmentation(const Corpus& training_corpus,
     std::shared_ptr<Model> model)
     : nodes_{}, model_{model} {
+  AddWords(training_corpus);
+}
+
+Segmentation::Segmentation(const Corpus& training_corpus,
+    std::shared_ptr<Model> model, std::string spill_path,
+    size_t max_resident_nodes)
+    : nodes_{}, model_{model} {
+  EnableSpilling(spill_path, max_resident_nodes);
+  AddWords(training_corpus);
+}
+
+void Segmentation::AddWords(const Corpus& training_corpus) {
   // The model has already initialized based on the corpus, so here we just
   // need to add the words to the data structure, without considering their
   // cost.
   for (auto iter = training_corpus.cbegin(); iter != training_corpus.cend();
       ++iter) {
     nodes_.emplace(iter->letters(), iter->frequency());
+    if (spill_ && nodes_.size() > max_resident_nodes_) {
+      ++touch_clock_;
+      SpillColdNodes(max_resident_nodes_ - max_resident_nodes_ / 10);
+    }
   }
 }
 
@@ -52,71 +282,596 @@ Segmentation::SegmentTestCorpus(const Corpus& test_corpus) {
   auto segmentations = std::make_shared<std::vector<std::string> >();
   segmentations->reserve(test_corpus.size());
 
-  auto log_token_count =
-      std::log(model_->total_morph_tokens());
+  for (auto iter = test_corpus.cbegin(); iter != test_corpus.cend(); ++iter) {
+    segmentations->push_back(iter->letters());
+  }  // for each word
+  SegmentBatch(segmentations.get());
+
+  return segmentations;
+}
+
+std::shared_ptr<std::vector<std::string> >
+Segmentation::SegmentTestCorpus(const Corpus& test_corpus,
+    const SegmentationCache& cache) {
+  auto segmentations = std::make_shared<std::vector<std::string> >();
+  segmentations->reserve(test_corpus.size());
 
+  std::vector<size_t> uncached;
+  std::vector<std::string> words;
   for (auto iter = test_corpus.cbegin(); iter != test_corpus.cend(); ++iter) {
-    auto word = iter->letters();
-    auto word_length = iter->length();
-    auto count = iter->frequency();
-
-    double bad_likelihood = (word_length + 1) * log_token_count;
-    double pseudo_infinite_cost = (word_length + 1) * bad_likelihood;
-
-    std::vector<double> delta(word_length + 1, 0.0);
-    std::vector<double> psi(word_length + 1, 0.0);
-
-    for (auto end_index = 1; end_index <= word_length; ++end_index) {
-      double best_delta = pseudo_infinite_cost;
-      double best_length = 0;
-
-      for (auto morph_length = 1; morph_length <= end_index; ++morph_length) {
-        auto morph = word.substr(end_index - morph_length, morph_length);
-        auto morph_cost = 0;
-        if (contains(morph)) {
-          morph_cost = log_token_count - std::log(at(morph).count);
-        } else if (morph_length == 1) {
-          // The morph was undefined, and only one letter long. Accept
-          // it with a bad likelihood.
-          morph_cost = bad_likelihood;
-        } else {
-          // The morph was undefined. Keep looking elsewhere.
-          continue;
+    const auto& word = iter->letters();
+    auto cached = cache.find(word);
+    if (cached != nullptr) {
+      segmentations->push_back(*cached);
+      continue;
+    }
+
+    uncached.push_back(segmentations->size());
+    words.push_back(word);
+    segmentations->emplace_back();
+  }  // for each word
+
+  SegmentBatch(&words);
+  for (size_t i = 0; i < uncached.size(); ++i) {
+    (*segmentations)[uncached[i]] = std::move(words[i]);
+  }
+  return segmentations;
+}
+
+struct Segmentation::ViterbiLaneState {
+  /// @param band The longest morph to consider, at most word_length.
+  ViterbiLaneState(size_t word_length, size_t band)
+      : word_length{word_length}, stride{word_length + 1}, band{band},
+        costs((word_length + 1) * (band + 1) * kViterbiLanes, kMissingCost),
+        delta(stride * kViterbiLanes, 0),
+        psi(stride * kViterbiLanes, 0) {}
+
+  /// The cost of a substring that is not a morph.
+  static constexpr int32_t kMissingCost =
+      std::numeric_limits<int32_t>::max();
+
+  size_t word_length;
+  size_t stride;
+  size_t band;
+
+  /// The cost of word[end - length, end) of each lane in steps, for
+  /// lengths up to band, at (end * (band + 1) + length) * kViterbiLanes
+  /// + lane. Only the band is kept, so the table grows with the length of
+  /// the word rather than its square.
+  std::vector<int32_t> costs;
+
+  /// The columns of the recurrences, at index * kViterbiLanes + lane.
+  std::vector<int64_t> delta;
+  std::vector<size_t> psi;
+
+  /// The word each lane split last.
+  std::string previous[kViterbiLanes];
+
+  /// Substrings to look up in the frozen lexicon, where in costs each
+  /// result goes, and the results.
+  std::vector<ViterbiLexicon::Probe> probes;
+  std::vector<size_t> targets;
+  std::vector<int> found;
+
+  /// Lookups in the frozen lexicon.
+  LexiconTierStats lookups;
+};
+
+constexpr int32_t Segmentation::ViterbiLaneState::kMissingCost;
+
+void Segmentation::SegmentBatch(std::vector<std::string>* words) const {
+  std::vector<std::vector<size_t>> morph_lengths;
+  SplitBatch(*words, &morph_lengths);
+  for (size_t i = 0; i < words->size(); ++i) {
+    auto& word = (*words)[i];
+    std::string str;
+    str.reserve(word.size() + morph_lengths[i].size());
+    size_t start_index = 0;
+    for (auto morph_length : morph_lengths[i]) {
+      str.append(word, start_index, morph_length);
+      str += ' ';
+      start_index += morph_length;
+    }
+    word = std::move(str);
+  }
+}
+
+void Segmentation::SplitBatch(const std::vector<std::string>& words,
+    std::vector<std::vector<size_t>>* morph_lengths) const {
+  morph_lengths->assign(words.size(), std::vector<size_t>{});
+
+  // Visit the words shortest first and alphabetically within a length, so
+  // that words of the same length sit next to each other and share
+  // prefixes with their neighbours.
+  std::vector<size_t> order(words.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), [&words](size_t a, size_t b) {
+    const auto& first = words[a];
+    const auto& second = words[b];
+    return first.size() != second.size() ? first.size() < second.size()
+        : first < second;
+  });
+
+  const std::string* lane_words[kViterbiLanes];
+  std::vector<size_t> lane_lengths[kViterbiLanes];
+  size_t next = 0;
+  while (next < order.size() && words[order[next]].empty()) {
+    ++next;
+  }
+  while (next < order.size()) {
+    auto length = words[order[next]].size();
+    auto end = next;
+    while (end < order.size() && words[order[end]].size() == length) {
+      ++end;
+    }
+
+    // Each lane takes its own run of the words of this length, so the
+    // word before a word in its lane is its alphabetical neighbour.
+    // Without the frozen lexicon no morph length is known to be too long,
+    // so the band would be the whole word; long words are split one at a
+    // time instead.
+    if (!frozen_ && length > kLongestUnfrozenLaneWord) {
+      for (auto position = next; position < end; ++position) {
+        (*morph_lengths)[order[position]] = ViterbiSplit(words[order[position]]);
+      }
+      next = end;
+      continue;
+    }
+
+    auto count = end - next;
+    auto run = (count + kViterbiLanes - 1) / kViterbiLanes;
+    ViterbiLaneState state{length,
+        frozen_ ? std::max<size_t>(1, std::min(length, frozen_->max_length()))
+            : length};
+    for (size_t step = 0; step < run; ++step) {
+      for (size_t lane = 0; lane < kViterbiLanes; ++lane) {
+        auto position = lane * run + step;
+        lane_words[lane] = position < count ?
+            &words[order[next + position]] : nullptr;
+      }
+      ViterbiSplitLanes(&state, lane_words, lane_lengths);
+
+      for (size_t lane = 0; lane < kViterbiLanes; ++lane) {
+        if (lane_words[lane] != nullptr) {
+          (*morph_lengths)[order[next + lane * run + step]] =
+              lane_lengths[lane];
         }
+      }
+    }
+    hot_hits_ += state.lookups.hot_hits;
+    cold_hits_ += state.lookups.cold_hits;
+    misses_ += state.lookups.misses;
+    next = end;
+  }
+}
+
+void Segmentation::Freeze(size_t hot_morphs, unsigned steps_per_nat) {
+  assert(!nodes_released_);
+  frozen_.reset(new ViterbiLexicon(model_->total_morph_tokens(),
+      steps_per_nat));
+  ForEachNode([this](const std::string& morph, const MorphNode& node) {
+    // A loaded model has an empty node for each line that is not a morph,
+    // which no search looks up.
+    if (!morph.empty()) {
+      frozen_->Add(morph, node.count);
+    }
+  });
+  frozen_->Reorder(hot_morphs);
+}
+
+void Segmentation::ReleaseNodes() {
+  assert(frozen_ && !spill_);
+  NodeMap().swap(nodes_);
+  nodes_released_ = true;
+}
+
+bool Segmentation::ApplyDelta(const ModelDelta& delta) {
+  std::unordered_set<std::string> changed;
+  for (const auto& change : delta.changes()) {
+    changed.insert(change.morph);
+  }
+  // Only the counts of leaves are in a model file, so a change to a morph
+  // that is split here is not one this can make.
+  uint64_t checksum = 0;
+  bool splits_changed = false;
+  ForEachNode([&](const std::string& morph, const MorphNode& node) {
+    if (morph.empty()) {
+      return;
+    }
+    if (node.left_child.empty()) {
+      checksum += LexiconEntryHash(morph, node.count);
+    } else if (changed.count(morph) > 0) {
+      splits_changed = true;
+    }
+  });
+  if (splits_changed || checksum != delta.old_checksum()
+      || model_->total_morph_tokens() != delta.old_total()) {
+    return false;
+  }
+
+  // Keep the frozen copy away from AdjustMorphCount, which drops it.
+  auto frozen = std::move(frozen_);
+  for (const auto& change : delta.changes()) {
+    AdjustMorphCount(change.morph, static_cast<int>(change.new_count)
+        - static_cast<int>(change.old_count));
+  }
+  if (frozen && !delta.Apply(frozen.get())) {
+    return false;
+  }
+  frozen_ = std::move(frozen);
+
+  checksum = 0;
+  ForEachNode([&checksum](const std::string& morph, const MorphNode& node) {
+    if (!morph.empty() && node.left_child.empty()) {
+      checksum += LexiconEntryHash(morph, node.count);
+    }
+  });
+  return checksum == delta.new_checksum();
+}
 
-        assert(end_index >= morph_length && end_index - morph_length < delta.size());
-        double current_delta = delta[end_index - morph_length] + morph_cost;
-        if (current_delta < best_delta) {
-          best_delta = current_delta;
-          best_length = morph_length;
+void Segmentation::ViterbiSplitLanes(ViterbiLaneState* state,
+    const std::string* const* words,
+    std::vector<size_t>* morph_lengths) const {
+  auto log_token_count =
+      std::log(model_->total_morph_tokens());
+  auto word_length = state->word_length;
+  auto band = state->band;
+  auto& costs = state->costs;
+  assert(word_length > 0);
+
+  // The same bounds as ViterbiSplit, which depend only on the length, in
+  // the steps of the frozen lexicon.
+  double steps_per_nat = frozen_ ? frozen_->steps_per_nat() : 1;
+  double bad_likelihood =
+      (word_length + 1) * log_token_count * steps_per_nat;
+  double pseudo_infinite_cost = (word_length + 1) * bad_likelihood;
+  assert(bad_likelihood < ViterbiLaneState::kMissingCost);
+
+  // Gather the cost of every substring that ends after the prefix a word
+  // shares with the previous word of its lane; the others are unchanged.
+  // Like ViterbiSplit, costs are whole numbers, and a morph that is not in
+  // the lexicon is skipped unless it is a single letter; here it gets
+  // kMissingCost instead, which is never the best.
+  auto unknown_letter_cost = static_cast<int32_t>(bad_likelihood);
+  auto first_changed = word_length;
+  for (size_t lane = 0; lane < kViterbiLanes; ++lane) {
+    if (words[lane] == nullptr) {
+      continue;
+    }
+    const auto& word = *words[lane];
+    assert(word.size() == word_length);
+    auto& previous = state->previous[lane];
+    size_t shared = 0;
+    while (shared < previous.size() && word[shared] == previous[shared]) {
+      ++shared;
+    }
+    previous = word;
+    first_changed = std::min(first_changed, shared);
+
+    for (auto end = shared + 1; end <= word_length; ++end) {
+      for (size_t length = 1; length <= std::min(end, band); ++length) {
+        costs[(end * (band + 1) + length) * kViterbiLanes + lane] =
+            ViterbiLaneState::kMissingCost;
+      }
+    }
+    for (size_t start = 0; start < word_length; ++start) {
+      auto first_end = std::max(start + 1, shared + 1);
+      if (first_end == start + 1) {
+        costs[((start + 1) * (band + 1) + 1) * kViterbiLanes + lane] =
+            unknown_letter_cost;
+      }
+      if (frozen_) {
+        // Extend the hash one letter at a time; no morph is longer than
+        // the longest one in the lexicon.
+        auto hash = ViterbiLexicon::HashStart();
+        auto last = std::min(word_length, start + frozen_->max_length());
+        for (auto end = start + 1; end <= last; ++end) {
+          hash = ViterbiLexicon::HashStep(hash, word[end - 1]);
+          if (end < first_end) {
+            continue;
+          }
+          auto target = (end * (band + 1) + end - start) * kViterbiLanes
+              + lane;
+          if (batch_probes_) {
+            state->probes.push_back(ViterbiLexicon::Probe{
+                word.data() + start, end - start, hash});
+            state->targets.push_back(target);
+            continue;
+          }
+          auto cost = frozen_->Find(word.data() + start, end - start, hash,
+              &state->lookups);
+          if (cost != ViterbiLexicon::kMissing) {
+            costs[target] = cost;
+          }
         }
-      }  // for each morph_length
+      } else {
+        std::string morph;
+        for (auto end = first_end; end <= word_length; ++end) {
+          morph.assign(word, start, end - start);
+          auto node = nodes_.find(morph);
+          if (node != nodes_.end()) {
+            costs[(end * (band + 1) + end - start) * kViterbiLanes + lane] =
+                static_cast<int>(
+                    log_token_count - std::log(node->second.count));
+          }
+        }
+      }
+    }
+  }
+
+  // Look up the substrings of all the lanes together, so that their cache
+  // misses overlap.
+  if (!state->probes.empty()) {
+    auto& found = state->found;
+    found.resize(state->probes.size());
+    frozen_->FindBatch(state->probes.data(), state->probes.size(),
+        found.data(), &state->lookups);
+    for (size_t i = 0; i < found.size(); ++i) {
+      if (found[i] != ViterbiLexicon::kMissing) {
+        costs[state->targets[i]] = found[i];
+      }
+    }
+    state->probes.clear();
+    state->targets.clear();
+  }
+
+  // One whole number per lane; the sums are exact, so comparing them gives
+  // the same choices as ViterbiSplit. GCC and Clang map the operations
+  // onto whatever vector registers the target has, at any optimization
+  // level.
+  typedef int64_t Lanes
+      __attribute__((vector_size(kViterbiLanes * sizeof(int64_t))));
+  typedef int32_t LaneCosts
+      __attribute__((vector_size(kViterbiLanes * sizeof(int32_t))));
+  static_assert(sizeof(Lanes) == kViterbiLanes * sizeof(int64_t),
+      "one number per lane");
+
+  // A sum is below pseudo_infinite_cost exactly when it is below the next
+  // whole number up. A missing morph costs that much, so it never wins.
+  auto limit = static_cast<int64_t>(std::ceil(pseudo_infinite_cost));
 
-      assert(end_index > 0 && end_index < delta.size());
-      delta[end_index] = best_delta;
-      psi[end_index] = best_length;
-    }  // for each end_index
+  // Columns up to the shortest shared prefix of the lanes are still valid.
+  auto& delta = state->delta;
+  auto& psi = state->psi;
+  for (auto end_index = first_changed + 1; end_index <= word_length;
+      ++end_index) {
+    Lanes best_delta = Lanes{} + limit;
+    Lanes best_length = Lanes{};
+    for (size_t morph_length = 1; morph_length <= std::min(end_index, band);
+        ++morph_length) {
+      Lanes previous;
+      LaneCosts morph_cost;
+      std::memcpy(&previous, &delta[(end_index - morph_length)
+          * kViterbiLanes], sizeof(Lanes));
+      std::memcpy(&morph_cost, &costs[(end_index * (band + 1)
+          + morph_length) * kViterbiLanes], sizeof(LaneCosts));
+      auto cost = __builtin_convertvector(morph_cost, Lanes);
+      cost = cost == ViterbiLaneState::kMissingCost ? Lanes{} + limit : cost;
+      Lanes current_delta = previous + cost;
+      auto better = current_delta < best_delta;
+      best_delta = better ? current_delta : best_delta;
+      best_length = better ? Lanes{} + static_cast<int64_t>(morph_length)
+          : best_length;
+    }  // for each morph_length
 
-    std::string str = "";
+    std::memcpy(&delta[end_index * kViterbiLanes], &best_delta,
+        sizeof(Lanes));
+    for (size_t lane = 0; lane < kViterbiLanes; ++lane) {
+      psi[end_index * kViterbiLanes + lane] =
+          static_cast<size_t>(best_length[lane]);
+    }
+  }  // for each end_index
+
+  // Trace the best path back from the end of each word.
+  for (size_t lane = 0; lane < kViterbiLanes; ++lane) {
+    if (words[lane] == nullptr) {
+      continue;
+    }
+    auto& lengths = morph_lengths[lane];
+    lengths.clear();
     auto end_index = word_length;
-    while (psi[end_index] != 0) {
-      assert(end_index > 0 && end_index < psi.size());
-      str = word.substr(end_index - psi[end_index], psi[end_index]) + " " + str;
-      end_index -= psi[end_index];
+    while (psi[end_index * kViterbiLanes + lane] != 0) {
+      lengths.push_back(psi[end_index * kViterbiLanes + lane]);
+      end_index -= lengths.back();
     }
-    segmentations->push_back(str);
-  }  // for each word
+    std::reverse(lengths.begin(), lengths.end());
+  }
+}
 
-  return segmentations;
+std::string Segmentation::SegmentWord(const std::string& word) const {
+  std::string str = "";
+  size_t start_index = 0;
+  for (auto morph_length : ViterbiSplit(word)) {
+    str += word.substr(start_index, morph_length) + " ";
+    start_index += morph_length;
+  }
+  return str;
+}
+
+std::vector<size_t> Segmentation::ViterbiSplit(const std::string& word) const {
+  assert(!nodes_released_);
+  auto log_token_count =
+      std::log(model_->total_morph_tokens());
+  auto word_length = word.length();
+
+  double bad_likelihood = (word_length + 1) * log_token_count;
+  double pseudo_infinite_cost = (word_length + 1) * bad_likelihood;
+
+  std::vector<double> delta(word_length + 1, 0.0);
+  std::vector<size_t> psi(word_length + 1, 0);
+
+  for (auto end_index = 1; end_index <= word_length; ++end_index) {
+    double best_delta = pseudo_infinite_cost;
+    size_t best_length = 0;
+
+    for (auto morph_length = 1; morph_length <= end_index; ++morph_length) {
+      auto node = nodes_.find(word.substr(end_index - morph_length,
+          morph_length));
+      auto morph_cost = 0;
+      if (node != nodes_.end()) {
+        morph_cost = log_token_count - std::log(node->second.count);
+      } else if (morph_length == 1) {
+        // The morph was undefined, and only one letter long. Accept
+        // it with a bad likelihood.
+        morph_cost = bad_likelihood;
+      } else {
+        // The morph was undefined. Keep looking elsewhere.
+        continue;
+      }
+
+      assert(end_index >= morph_length && end_index - morph_length < delta.size());
+      double current_delta = delta[end_index - morph_length] + morph_cost;
+      if (current_delta < best_delta) {
+        best_delta = current_delta;
+        best_length = morph_length;
+      }
+    }  // for each morph_length
+
+    assert(end_index > 0 && end_index < delta.size());
+    delta[end_index] = best_delta;
+    psi[end_index] = best_length;
+  }  // for each end_index
+
+  // Trace the best path back from the end of the word.
+  std::vector<size_t> morph_lengths;
+  auto end_index = word_length;
+  while (psi[end_index] != 0) {
+    assert(end_index > 0 && end_index < psi.size());
+    morph_lengths.push_back(psi[end_index]);
+    end_index -= psi[end_index];
+  }
+  std::reverse(morph_lengths.begin(), morph_lengths.end());
+  return morph_lengths;
+}
+
+double Segmentation::Score(const Corpus& heldout, size_t threads) const {
+  assert(threads > 0);
+  auto log_token_count = std::log(model_->total_morph_tokens());
+
+  // The words are summed in blocks, and the blocks in order, so that the
+  // rounding is the same whatever the number of threads.
+  constexpr size_t kBlockWords = 4096;
+  auto blocks = (heldout.size() + kBlockWords - 1) / kBlockWords;
+  std::vector<double> block_costs(blocks, 0.0);
+  auto score_every = [&](size_t first) {
+    std::vector<double> best;
+    std::string morph;
+    for (auto block = first; block < blocks; block += threads) {
+      auto begin = heldout.cbegin() + block * kBlockWords;
+      auto end = heldout.cbegin()
+          + std::min(heldout.size(), (block + 1) * kBlockWords);
+      double block_cost = 0;
+      for (auto iter = begin; iter != end; ++iter) {
+        const auto& word = iter->letters();
+        if (word.empty() || iter->frequency() == 0) {
+          continue;
+        }
+        double bad_likelihood = (word.size() + 1) * log_token_count;
+        best.assign(word.size() + 1, 0.0);
+        for (size_t end_index = 1; end_index <= word.size(); ++end_index) {
+          auto best_cost = std::numeric_limits<double>::infinity();
+          for (size_t morph_length = 1; morph_length <= end_index;
+              ++morph_length) {
+            morph.assign(word, end_index - morph_length, morph_length);
+            auto node = nodes_.find(morph);
+            double morph_cost;
+            if (node != nodes_.end() && !node->second.has_children()
+                && node->second.count > 0) {
+              morph_cost = log_token_count - std::log(node->second.count);
+            } else if (morph_length == 1) {
+              morph_cost = bad_likelihood;
+            } else {
+              continue;
+            }
+            best_cost = std::min(best_cost,
+                best[end_index - morph_length] + morph_cost);
+          }
+          best[end_index] = best_cost;
+        }
+        block_cost += iter->frequency() * best[word.size()];
+      }
+      block_costs[block] = block_cost;
+    }
+  };
+  std::vector<std::thread> workers;
+  for (size_t thread = 1; thread < threads && thread < blocks; ++thread) {
+    workers.emplace_back(score_every, thread);
+  }
+  score_every(0);
+  for (auto& worker : workers) {
+    worker.join();
+  }
+
+  double cost = 0;
+  for (auto block_cost : block_costs) {
+    cost += block_cost;
+  }
+  return cost;
+}
+
+std::ostream& Segmentation::SegmentText(std::istream& in, std::ostream& out,
+    const std::string& separator) const {
+  // The text before each word, the word as written and in lower case. The
+  // tokenizer reuses its buffer, so they are copied.
+  std::vector<std::string> gaps(1);
+  std::vector<std::string> words;
+  std::vector<std::string> lower;
+  std::vector<std::vector<size_t>> morph_lengths;
+  auto flush = [&]() {
+    SplitBatch(lower, &morph_lengths);
+    for (size_t i = 0; i < words.size(); ++i) {
+      out << gaps[i];
+      size_t morph_start = 0;
+      for (auto morph_length : morph_lengths[i]) {
+        if (morph_start > 0) {
+          out << separator;
+        }
+        out.write(words[i].data() + morph_start, morph_length);
+        morph_start += morph_length;
+      }
+    }
+    gaps.front().swap(gaps.back());
+    gaps.resize(1);
+    words.clear();
+    lower.clear();
+  };
+
+  Tokenize(in,
+      [&gaps](const char* gap, size_t length) {
+        gaps.back().append(gap, length);
+      },
+      [&](const char* word, size_t length) {
+        words.emplace_back(word, length);
+        lower.push_back(words.back());
+        for (auto& c : lower.back()) {
+          if (c >= 'A' && c <= 'Z') {
+            c += 'a' - 'A';
+          }
+        }
+        gaps.emplace_back();
+        if (words.size() == kTextBatchWords) {
+          flush();
+        }
+      });
+  flush();
+  out << gaps.front();
+  return out;
 }
 
 void Segmentation::AdjustMorphCount(std::string morph, int delta) {
   // Precondition check: Morph string cannot be empty.
   assert(!morph.empty());
 
+  // The frozen copy of the lexicon would be out of date.
+  if (frozen_) {
+    frozen_.reset();
+  }
+
   // Either find the morph in the data structure, or create it.
   // The count of a created node is 0.
-  MorphNode& subtree = nodes_[morph];
+  MorphNode& subtree = Touch(morph);
 
   // Precondition check: Never allow node counts to become negative.
   assert(delta >= 0 || -delta <= subtree.count);
@@ -179,6 +934,9 @@ void Segmentation::ResplitNode(std::string morph) {
   assert(!morph.empty());
 
   // We'll be deleting the morph next, so remember its count.
+  if (spill_) {
+    Restore(morph);
+  }
   auto frequency = nodes_.at(morph).count;
 
   // Remove the current representation of the node, if we have it. This
@@ -245,48 +1003,332 @@ void Segmentation::ResplitNode(std::string morph) {
 void Segmentation::Optimize() {
   std::vector<std::string> keys;
   // Collect all the nodes we will iterate over
-  for (const auto& node_pair : nodes_) {
-    keys.push_back(node_pair.first);
+  ForEachNode([&keys](const std::string& morph, const MorphNode&) {
+    keys.push_back(morph);
+  });
+  Optimize(std::move(keys));
+}
+
+void Segmentation::Optimize(const Corpus& training_corpus) {
+  std::vector<std::string> keys;
+  keys.reserve(training_corpus.size());
+  for (auto iter = training_corpus.cbegin(); iter != training_corpus.cend();
+      ++iter) {
+    if (!iter->letters().empty()) {
+      keys.push_back(iter->letters());
+    }
   }
+  Optimize(std::move(keys));
+}
 
+void Segmentation::Optimize(std::vector<std::string> keys) {
   // Word list is randomly shuffled on each iteration
   std::random_device rd;
-  std::mt19937 g(rd());
+  std::mt19937 g(has_seed_ ? seed_ : rd());
 
+  epoch_seconds_.clear();
+  heldout_costs_.clear();
+  auto optimize_start = std::chrono::steady_clock::now();
   auto old_cost = model_->overall_cost();
   auto new_cost = old_cost;
+  size_t best_heldout_epoch = 0;
+  bool heldout_stalled = false;
+  std::unique_ptr<ResplitWorkers> workers;
+  if (threads_ > 0) {
+    workers.reset(new ResplitWorkers{nodes_, *model_, threads_});
+  }
   do {
+    auto epoch_start = std::chrono::steady_clock::now();
     std::shuffle(keys.begin(), keys.end(), g);
 
+    auto report_if_requested = [&](size_t position) {
+      if (progress_request_ != nullptr && *progress_request_ != 0) {
+        *progress_request_ = 0;
+        auto now = std::chrono::steady_clock::now();
+        report_progress_(OptimizeProgress{epoch_seconds_.size() + 1,
+            position, keys.size(),
+            std::chrono::duration<double>(now - epoch_start).count(),
+            std::chrono::duration<double>(now - optimize_start).count()});
+      }
+    };
+
     // Try splitting all the nodes
     old_cost = new_cost;
-    for (const auto& key : keys) {
-      ResplitNode(key);
+    if (workers) {
+      for (size_t begin = 0; begin < keys.size(); begin += batch_words_) {
+        report_if_requested(begin);
+        ResplitBatch(workers.get(), keys, begin,
+            std::min(keys.size(), begin + batch_words_));
+      }
+    } else {
+      size_t position = 0;
+      for (const auto& key : keys) {
+        report_if_requested(position);
+        ++position;
+        ++touch_clock_;
+        ResplitNode(key);
+        if (spill_ && nodes_.size() > max_resident_nodes_) {
+          // Leave some headroom so that spilling happens in batches.
+          SpillColdNodes(max_resident_nodes_ - max_resident_nodes_ / 10);
+        }
+      }
     }
     new_cost = model_->overall_cost();
-  } while (old_cost - new_cost > model_->convergence_threshold());
+    if (spill_) {
+      spill_->Compact();
+    }
+
+    // The held-out score is part of the epoch, since it decides whether
+    // there is another.
+    if (heldout_) {
+      heldout_costs_.push_back(Score(*heldout_, score_threads_));
+      if (heldout_costs_.back() < heldout_costs_[best_heldout_epoch]) {
+        best_heldout_epoch = heldout_costs_.size() - 1;
+      }
+      heldout_stalled = heldout_patience_ > 0
+          && heldout_costs_.size() - 1 - best_heldout_epoch
+              >= heldout_patience_;
+    }
+
+    epoch_seconds_.push_back(std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - epoch_start).count());
+  } while (old_cost - new_cost > model_->convergence_threshold()
+      && !heldout_stalled);
+}
+
+void Segmentation::ResplitBatch(ResplitWorkers* workers,
+    const std::vector<std::string>& keys, size_t begin, size_t end) {
+  batch_splits_.resize(std::max(batch_splits_.size(), end - begin));
+  workers->Resplit(keys, begin, end, &batch_splits_);
+  for (auto i = begin; i < end; ++i) {
+    size_t next = 0;
+    ApplyResplit(keys[i], batch_splits_[i - begin], &next);
+  }
+}
+
+void Segmentation::ApplyResplit(const std::string& morph,
+    const std::vector<size_t>& split_indices, size_t* next) {
+  // Same as ResplitNode, with the split positions already chosen. The counts
+  // may have changed since they were chosen, so they are read again here.
+  auto split_index = split_indices.at((*next)++);
+  auto frequency = nodes_.at(morph).count;
+  AdjustMorphCount(morph, -frequency);
+  if (split_index > 0) {
+    auto& parent = nodes_[morph];
+    parent.count = frequency;
+    parent.left_child = morph.substr(0, split_index);
+    parent.right_child = morph.substr(split_index);
+    auto left_child = parent.left_child;
+    auto right_child = parent.right_child;
+    AdjustMorphCount(left_child, frequency);
+    AdjustMorphCount(right_child, frequency);
+    ApplyResplit(left_child, split_indices, next);
+    ApplyResplit(right_child, split_indices, next);
+  } else {
+    AdjustMorphCount(morph, frequency);
+  }
+}
+
+size_t Segmentation::SeedSplits(const Corpus& training_corpus,
+    const BoundaryStatistics& statistics, double threshold) {
+  size_t seeded = 0;
+  size_t index = 0;
+  for (auto iter = training_corpus.cbegin(); iter != training_corpus.cend();
+      ++iter, ++index) {
+    const auto& word = iter->letters();
+    if (word.size() > 1 && SeedSpan(word, index, 0, word.size(), statistics,
+        threshold)) {
+      ++seeded;
+    }
+  }
+  return seeded;
+}
+
+bool Segmentation::SeedSpan(const std::string& word, size_t index,
+    size_t start, size_t end, const BoundaryStatistics& statistics,
+    double threshold) {
+  auto morph = word.substr(start, end - start);
+  auto node = Restore(morph);
+  if (node == nodes_.end()) {
+    return false;
+  }
+
+  // Another word may already have split this morph; keep that split and
+  // look for boundaries inside its parts.
+  size_t split = 0;
+  if (!node->second.left_child.empty()) {
+    split = start + node->second.left_child.size();
+  } else {
+    auto best_score = threshold;
+    for (auto position = start + 1; position < end; ++position) {
+      auto score = statistics.score(index, position);
+      if (score > best_score) {
+        best_score = score;
+        split = position;
+      }
+    }
+    if (split == 0) {
+      return false;
+    }
+
+    // Same as the end of ResplitNode: the parent leaves the model and its
+    // count moves to the two children.
+    auto frequency = node->second.count;
+    auto old_cost = model_->overall_cost();
+    AdjustMorphCount(morph, -frequency);
+    auto& parent = nodes_[morph];
+    parent.count = frequency;
+    parent.left_child = word.substr(start, split - start);
+    parent.right_child = word.substr(split, end - split);
+    AdjustMorphCount(parent.left_child, frequency);
+    AdjustMorphCount(parent.right_child, frequency);
+
+    // The statistics ignore word frequencies, so a boundary that is common
+    // among word types can still be a bad split for a frequent word. Keep
+    // the split only if the model agrees.
+    if (model_->overall_cost() >= old_cost) {
+      AdjustMorphCount(morph, -frequency);
+      AdjustMorphCount(morph, frequency);
+      return false;
+    }
+  }
+
+  SeedSpan(word, index, start, split, statistics, threshold);
+  SeedSpan(word, index, split, end, statistics, threshold);
+  return true;
+}
+
+void Segmentation::RemoveWords(const Corpus& words) {
+  for (auto iter = words.cbegin(); iter != words.cend(); ++iter) {
+    const auto& word = iter->letters();
+    if (!word.empty() && Restore(word) != nodes_.end()) {
+      AdjustMorphCount(word, -nodes_.at(word).count);
+    }
+  }
+}
+
+size_t Segmentation::AddViterbiSplits(const Corpus& words) {
+  // The search only sees nodes in memory.
+  Unspill();
+
+  std::vector<std::pair<const Morph*, std::vector<size_t>>> splits;
+  for (auto iter = words.cbegin(); iter != words.cend(); ++iter) {
+    if (!iter->letters().empty()) {
+      splits.emplace_back(&*iter, ViterbiSplit(iter->letters()));
+    }
+  }
+
+  for (const auto& split : splits) {
+    AddSplit(split.first->letters(), split.first->frequency(),
+        split.second.data(), split.second.size());
+  }
+  return splits.size();
+}
+
+void Segmentation::AddSplit(const std::string& morph, size_t count,
+    const size_t* lengths, size_t parts) {
+  if (parts == 1 || contains(morph)) {
+    AdjustMorphCount(morph, count);
+    return;
+  }
+
+  // Same as the end of ResplitNode: the parent is not in the model, only
+  // its parts are.
+  auto& parent = nodes_[morph];
+  parent.count = count;
+  parent.left_child = morph.substr(0, lengths[0]);
+  parent.right_child = morph.substr(lengths[0]);
+  auto left_child = parent.left_child;
+  auto right_child = parent.right_child;
+  AdjustMorphCount(left_child, count);
+  AddSplit(right_child, count, lengths + 1, parts - 1);
+}
+
+void Segmentation::EnableSpilling(std::string path,
+    size_t max_resident_nodes) {
+  assert(max_resident_nodes > 0);
+  spill_ = std::make_unique<SpillFile>(path);
+  max_resident_nodes_ = max_resident_nodes;
+  ++touch_clock_;
+  SpillColdNodes(max_resident_nodes_);
+}
+
+Segmentation::NodeMap::iterator Segmentation::Restore(
+    const std::string& morph) {
+  auto iter = nodes_.find(morph);
+  if (iter == nodes_.end() && spill_) {
+    MorphNode node;
+    if (spill_->PageIn(morph, &node)) {
+      iter = nodes_.emplace(morph, node).first;
+    }
+  }
+  return iter;
+}
+
+void Segmentation::Unspill() {
+  if (spill_) {
+    spill_->PageInAll([this](std::string morph, const MorphNode& node) {
+      nodes_.emplace(std::move(morph), node);
+    });
+  }
+}
+
+MorphNode& Segmentation::Touch(const std::string& morph) {
+  assert(!nodes_released_);
+  auto iter = Restore(morph);
+  if (iter == nodes_.end()) {
+    iter = nodes_.emplace(morph, MorphNode()).first;
+  }
+  iter->second.last_touched = touch_clock_;
+  return iter->second;
+}
+
+void Segmentation::SpillColdNodes(size_t target_resident_nodes) {
+  if (nodes_.size() <= target_resident_nodes) {
+    return;
+  }
+
+  // Rank nodes by count, then by how long ago they were used. Nodes used
+  // for the current word stay in memory.
+  using Candidate = std::tuple<size_t, size_t, const std::string*>;
+  std::vector<Candidate> candidates;
+  candidates.reserve(nodes_.size());
+  for (const auto& node_pair : nodes_) {
+    if (node_pair.second.last_touched < touch_clock_) {
+      candidates.emplace_back(node_pair.second.count,
+          node_pair.second.last_touched, &node_pair.first);
+    }
+  }
+
+  auto excess = std::min(nodes_.size() - target_resident_nodes,
+      candidates.size());
+  std::nth_element(candidates.begin(), candidates.begin() + excess,
+      candidates.end());
+  candidates.resize(excess);
+
+  for (const auto& candidate : candidates) {
+    auto iter = nodes_.find(*std::get<2>(candidate));
+    spill_->Evict(iter->first, iter->second);
+    nodes_.erase(iter);
+  }
 }
 
 std::ostream& Segmentation::print(std::ostream& out) const {
   out << "Overall cost: " << std::setiosflags(std::ios::fixed)
       << std::setprecision(5)
       << model_->overall_cost() << std::endl;
-  for (const auto& iter : nodes_) {
-    if (!iter.second.has_children()) {
-      auto& morph_string = iter.first;
-      auto& node = iter.second;
+  ForEachNode([&out](const std::string& morph_string, const MorphNode& node) {
+    if (!node.has_children()) {
       out << node.count << " " << morph_string << std::endl;
     }
-  }
+  });
   return out;
 }
 
 std::ostream& Segmentation::print_dot(std::ostream& out) const {
   out << "digraph segmentation_tree {" << std::endl;
   out << "node [shape=record, fontname=\"Arial\"]" << std::endl;
-  for (const auto& iter : nodes_) {
-    auto& morph_string = iter.first;
-    auto& node = iter.second;
+  ForEachNode([&out](const std::string& morph_string, const MorphNode& node) {
     //out << node.count << " " << morph_string << std::endl;
     out << "\"" << morph_string << "\" [label=\"" << morph_string << "| "
         << node.count << "\"]" << std::endl;
@@ -298,7 +1340,7 @@ std::ostream& Segmentation::print_dot(std::ostream& out) const {
       out << "\"" << morph_string << "\" -> \""
           << node.right_child << "\"" << std::endl;
     }
-  }
+  });
   out << "}" << std::endl;
   return out;
 }
@@ -308,13 +1350,37 @@ std::ostream& Segmentation::print_dot_debug() const {
   return print_dot(out);
 }
 
+std::ostream& Segmentation::print_front_coded(std::ostream& out) const {
+  std::vector<Morph> morphs;
+  ForEachNode([&morphs](const std::string& morph_string,
+      const MorphNode& node) {
+    if (!node.has_children()) {
+      morphs.emplace_back(morph_string, node.count);
+    }
+  });
+  out.write(Corpus::kFrontCodedMagic, sizeof(Corpus::kFrontCodedMagic) - 1);
+  double cost = model_->overall_cost();
+  out.write(reinterpret_cast<const char*>(&cost), sizeof(cost));
+  FrontCodedDictionary{std::move(morphs)}.Write(out);
+  return out;
+}
+
 std::ostream& Segmentation::print_as_corpus(std::ostream& out) const {
-  for (const auto& iter : nodes_) {
-    auto& morph_string = iter.first;
-    auto& node = iter.second;
+  ForEachNode([&out](const std::string& morph_string, const MorphNode& node) {
     if (!node.has_children()) {
       out << node.count << " " << morph_string << std::endl;
     }
+  });
+  return out;
+}
+
+void Segmentation::ForEachNode(const std::function<void(const std::string&,
+    const MorphNode&)>& visit) const {
+  for (const auto& iter : nodes_) {
+    visit(iter.first, iter.second);
+  }
+  if (spill_) {
+    spill_->ForEach(visit);
   }
 }
 
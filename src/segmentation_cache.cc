@@ -0,0 +1,209 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "segmentation_cache.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <unordered_set>
+
+namespace morfessor {
+
+namespace {
+
+/// Returns a cost in the whole steps that the Viterbi search uses, the
+/// same way Segmentation::ViterbiSplit and ViterbiLexicon round it.
+int WholeSteps(double nats, unsigned steps_per_nat) {
+  return static_cast<int>(steps_per_nat * nats);
+}
+
+}  // namespace
+
+SegmentationCache::SegmentationCache(std::istream& in) {
+  init(in);
+}
+
+SegmentationCache::SegmentationCache(std::string segmentation_file) {
+  std::ifstream file{segmentation_file};
+  assert(file.is_open());
+  init(file);
+}
+
+void SegmentationCache::init(std::istream& in) {
+  std::string line;
+  while (getline(in, line)) {
+    std::stringstream ssline{line};
+    std::string word;
+    std::vector<std::string> morphs;
+    std::string morph;
+    while (ssline >> morph) {
+      word += morph;
+      morphs.push_back(morph);
+    }
+    if (word.empty() || index_.find(word) != index_.end()) {
+      continue;
+    }
+
+    auto position = words_.size();
+    index_.emplace(word, position);
+    words_.push_back(word);
+    lines_.push_back(line);
+    stale_.push_back(false);
+    for (const auto& used : morphs) {
+      auto& users = users_[used];
+      // A morph can occur twice in one word; index the word once.
+      if (users.empty() || users.back() != position) {
+        users.push_back(position);
+      }
+    }
+  }
+}
+
+size_t SegmentationCache::MarkUsers(const std::string& morph) {
+  auto users = users_.find(morph);
+  if (users == users_.end()) {
+    return 0;
+  }
+  size_t invalidated = 0;
+  for (auto position : users->second) {
+    if (!stale_[position]) {
+      stale_[position] = true;
+      ++invalidated;
+    }
+  }
+  return invalidated;
+}
+
+size_t SegmentationCache::Invalidate(const LexiconDiff& diff,
+    unsigned steps_per_nat) {
+  size_t invalidated = 0;
+
+  // Words whose best path went through a changed morph, and the morphs that
+  // became cheaper, which might now beat the path a word used before.
+  std::unordered_set<std::string> cheaper;
+  for (const auto& change : diff.changes()) {
+    invalidated += MarkUsers(change.first);
+    if (diff.gained(change.first)) {
+      cheaper.insert(change.first);
+    }
+  }
+
+  if (diff.old_total() != diff.new_total()) {
+    // A cost is log(total) - log(count) rounded down to whole steps, so a
+    // morph whose count is the same can still cost a step more or less.
+    auto old_log_total = std::log(diff.old_total());
+    auto new_log_total = std::log(diff.new_total());
+    std::vector<bool> known_letters(256);
+    for (const auto& entry : diff.unchanged()) {
+      auto log_count = std::log(entry.second);
+      auto old_cost = WholeSteps(old_log_total - log_count, steps_per_nat);
+      auto new_cost = WholeSteps(new_log_total - log_count, steps_per_nat);
+      if (new_cost != old_cost) {
+        invalidated += MarkUsers(entry.first);
+        if (new_cost < old_cost) {
+          cheaper.insert(entry.first);
+        }
+      }
+      if (entry.first.length() == 1) {
+        known_letters[static_cast<unsigned char>(entry.first[0])] = true;
+      }
+    }
+    for (const auto& change : diff.changes()) {
+      if (change.first.length() == 1 && change.second.second > 0) {
+        known_letters[static_cast<unsigned char>(change.first[0])] = true;
+      }
+    }
+
+    // A letter that is not in the lexicon costs (length + 1) * log(total)
+    // in a word of that length.
+    for (size_t position = 0; position < words_.size(); ++position) {
+      const auto& word = words_[position];
+      if (stale_[position]
+          || WholeSteps((word.length() + 1) * old_log_total, steps_per_nat)
+              == WholeSteps((word.length() + 1) * new_log_total,
+                  steps_per_nat)) {
+        continue;
+      }
+      for (unsigned char letter : word) {
+        if (!known_letters[letter]) {
+          stale_[position] = true;
+          ++invalidated;
+          break;
+        }
+      }
+    }
+  }
+
+  if (cheaper.empty()) {
+    return invalidated;
+  }
+
+  // Only few morphs get cheaper, so most substrings can be ruled out by
+  // their first two letters before they are hashed.
+  size_t max_length = 0;
+  std::vector<bool> cheaper_starts(1 << 16);
+  for (const auto& morph : cheaper) {
+    max_length = std::max(max_length, morph.length());
+    auto first = static_cast<unsigned char>(morph[0]);
+    if (morph.length() == 1) {
+      for (unsigned second = 0; second < 256; ++second) {
+        cheaper_starts[first << 8 | second] = true;
+      }
+    } else {
+      cheaper_starts[first << 8 | static_cast<unsigned char>(morph[1])] =
+          true;
+    }
+  }
+
+  std::string morph;
+  for (size_t position = 0; position < words_.size(); ++position) {
+    if (stale_[position]) {
+      continue;
+    }
+    const auto& word = words_[position];
+    for (size_t start = 0; start < word.length() && !stale_[position];
+        ++start) {
+      auto first = static_cast<unsigned char>(word[start]);
+      auto second = start + 1 < word.length()
+          ? static_cast<unsigned char>(word[start + 1]) : 0;
+      if (!cheaper_starts[first << 8 | second]) {
+        continue;
+      }
+      for (size_t length = 1;
+          length <= max_length && start + length <= word.length(); ++length) {
+        morph.assign(word, start, length);
+        if (cheaper.find(morph) != cheaper.end()) {
+          stale_[position] = true;
+          ++invalidated;
+          break;
+        }
+      }
+    }
+  }
+
+  return invalidated;
+}
+
+} // namespace morfessor
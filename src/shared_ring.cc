@@ -0,0 +1,236 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "shared_ring.h"
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+
+namespace morfessor {
+
+constexpr size_t SharedRing::kSlots;
+constexpr size_t SharedRing::kMaxWordBytes;
+constexpr size_t SharedRing::kMaxModels;
+constexpr size_t SharedRing::kMaxNameBytes;
+
+namespace {
+
+constexpr uint32_t kMagic = 0x4d524e47;  // "MRNG"
+
+/// How often a side checks for work before it goes to sleep. A few
+/// microseconds of spinning covers the gap between the batches of a busy
+/// client without a system call. With a single core the other side cannot
+/// run while this one spins, so it sleeps at once.
+constexpr int kSpins = 4000;
+
+int Spins() {
+  static const int spins = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? kSpins : 0;
+  return spins;
+}
+
+inline void Relax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#endif
+}
+
+// The futexes are shared between processes, so they are not private.
+void FutexWait(std::atomic<uint32_t>* word, uint32_t value) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, value,
+      nullptr, nullptr, 0);
+}
+
+void FutexWake(std::atomic<uint32_t>* word) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, INT_MAX,
+      nullptr, nullptr, 0);
+}
+
+}  // namespace
+
+SharedRing::SharedRing(const std::string& path, bool create,
+    const std::vector<std::string>& models)
+    : path_{path}, created_{create},
+      bytes_{sizeof(Header) + kSlots * sizeof(Slot)} {
+  static_assert(sizeof(Slot) == 256, "slots should fill whole cache lines");
+  static_assert(sizeof(Header) % 64 == 0, "slots should be aligned");
+
+  // A new ring is set up under another name and then renamed, so that a
+  // client never opens it half made.
+  auto file_path = create ? path + ".new" : path;
+  int fd = open(file_path.c_str(), create ? O_RDWR | O_CREAT | O_TRUNC
+      : O_RDWR, 0600);
+  assert(fd != -1);
+  if (create) {
+    int resized = ftruncate(fd, bytes_);
+    assert(resized == 0);
+    (void) resized;
+  }
+  void* memory = mmap(nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_SHARED,
+      fd, 0);
+  assert(memory != MAP_FAILED);
+  close(fd);
+  header_ = static_cast<Header*>(memory);
+  slots_ = reinterpret_cast<Slot*>(header_ + 1);
+
+  if (create) {
+    assert(models.size() <= kMaxModels);
+    header_->models = models.size();
+    for (size_t i = 0; i < models.size(); ++i) {
+      assert(models[i].size() <= kMaxNameBytes);
+      models[i].copy(header_->names[i], kMaxNameBytes);
+    }
+    header_->magic = kMagic;
+    int renamed = std::rename(file_path.c_str(), path.c_str());
+    assert(renamed == 0);
+    (void) renamed;
+  }
+  assert(header_->magic == kMagic);
+}
+
+SharedRing::~SharedRing() {
+  munmap(header_, bytes_);
+  if (created_) {
+    unlink(path_.c_str());
+  }
+}
+
+int SharedRing::model(const std::string& name) const {
+  for (uint32_t i = 0; i < header_->models; ++i) {
+    if (name == header_->names[i]) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+SharedRing::Slot& SharedRing::slot(uint32_t sequence) noexcept {
+  return slots_[sequence % kSlots];
+}
+
+void SharedRing::PublishRequests(uint32_t requested) {
+  Publish(&header_->requested, requested);
+}
+
+uint32_t SharedRing::WaitForRequests(uint32_t seen) {
+  return Wait(&header_->requested, &header_->closed, seen);
+}
+
+void SharedRing::PublishAnswers(uint32_t answered) {
+  Publish(&header_->answered, answered);
+}
+
+uint32_t SharedRing::WaitForAnswers(uint32_t seen) {
+  return Wait(&header_->answered, nullptr, seen);
+}
+
+void SharedRing::Close() {
+  header_->closed.store(1);
+  Ring(&header_->requested);
+}
+
+uint32_t SharedRing::Wait(Signal* signal,
+    const std::atomic<uint32_t>* closed, uint32_t seen) {
+  auto done = [&](uint32_t count) {
+    return count != seen || (closed != nullptr && closed->load() != 0);
+  };
+  for (int i = 0; i < Spins(); ++i) {
+    auto count = signal->count.load(std::memory_order_acquire);
+    if (done(count)) {
+      return count;
+    }
+    Relax();
+  }
+  // The flag is raised before the last look at the count, and Publish
+  // stores the count before it looks at the flag, so either this sees the
+  // new count or the bell rings after it was read, and the futex does not
+  // sleep.
+  for (;;) {
+    signal->sleeps.store(1);
+    auto bell = signal->bell.load();
+    auto count = signal->count.load();
+    if (done(count)) {
+      signal->sleeps.store(0);
+      return count;
+    }
+    FutexWait(&signal->bell, bell);
+  }
+}
+
+void SharedRing::Publish(Signal* signal, uint32_t count) {
+  signal->count.store(count);
+  if (signal->sleeps.load() != 0) {
+    Ring(signal);
+  }
+}
+
+void SharedRing::Ring(Signal* signal) {
+  signal->bell.fetch_add(1);
+  FutexWake(&signal->bell);
+}
+
+RingClient::RingClient(const std::string& path) : ring_{path, false} {
+}
+
+RingClient::~RingClient() {
+  ring_.Close();
+}
+
+size_t RingClient::room() const noexcept {
+  return SharedRing::kSlots - (pushed_ - popped_);
+}
+
+void RingClient::Push(int model, const char* word, size_t length) {
+  assert(room() > 0);
+  assert(model >= 0 && model < 256);
+  assert(length <= SharedRing::kMaxWordBytes);
+  auto& slot = ring_.slot(pushed_++);
+  slot.model = static_cast<uint8_t>(model);
+  slot.length = static_cast<uint8_t>(length);
+  std::memcpy(slot.word, word, length);
+}
+
+void RingClient::Flush() {
+  if (flushed_ != pushed_) {
+    flushed_ = pushed_;
+    ring_.PublishRequests(flushed_);
+  }
+}
+
+const uint8_t* RingClient::Pop(size_t* morphs) {
+  assert(popped_ != flushed_);
+  while (popped_ == answered_) {
+    answered_ = ring_.WaitForAnswers(answered_);
+  }
+  auto& slot = ring_.slot(popped_++);
+  *morphs = slot.morphs;
+  return slot.ends;
+}
+
+} // namespace morfessor
@@ -0,0 +1,176 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "spill_file.h"
+
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+
+namespace morfessor {
+
+namespace {
+
+/// Size of a record on disk: three length-prefixed strings and a count.
+size_t RecordBytes(const std::string& morph, const MorphNode& node) {
+  return 3 * sizeof(uint32_t) + sizeof(uint64_t) + morph.size()
+      + node.left_child.size() + node.right_child.size();
+}
+
+void WriteString(std::ostream& out, const std::string& str) {
+  uint32_t length = str.size();
+  out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+  out.write(str.data(), length);
+}
+
+void ReadString(std::istream& in, std::string* str) {
+  uint32_t length = 0;
+  in.read(reinterpret_cast<char*>(&length), sizeof(length));
+  str->resize(length);
+  in.read(&(*str)[0], length);
+}
+
+}  // namespace
+
+SpillFile::SpillFile(std::string path)
+    : path_{path} {
+  Truncate();
+}
+
+SpillFile::~SpillFile() {
+  file_.close();
+  std::remove(path_.c_str());
+}
+
+void SpillFile::Truncate() {
+  file_.close();
+  file_.open(path_, std::ios::in | std::ios::out | std::ios::trunc
+      | std::ios::binary);
+  assert(file_.is_open());
+  file_bytes_ = 0;
+  live_bytes_ = 0;
+}
+
+std::streamoff SpillFile::Write(std::fstream& file, const std::string& morph,
+    const MorphNode& node) {
+  file.seekp(0, std::ios::end);
+  std::streamoff offset = file.tellp();
+  WriteString(file, morph);
+  uint64_t count = node.count;
+  file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+  WriteString(file, node.left_child);
+  WriteString(file, node.right_child);
+  assert(file.good());
+
+  auto bytes = RecordBytes(morph, node);
+  file_bytes_ += bytes;
+  live_bytes_ += bytes;
+  stats_.bytes_written += bytes;
+  return offset;
+}
+
+void SpillFile::Read(std::streamoff offset, std::string* morph,
+    MorphNode* node) const {
+  file_.seekg(offset);
+  ReadString(file_, morph);
+  uint64_t count = 0;
+  file_.read(reinterpret_cast<char*>(&count), sizeof(count));
+  node->count = count;
+  ReadString(file_, &node->left_child);
+  ReadString(file_, &node->right_child);
+  assert(file_.good());
+  stats_.bytes_read += RecordBytes(*morph, *node);
+}
+
+void SpillFile::Evict(const std::string& morph, const MorphNode& node) {
+  index_.emplace(hash_(morph), Write(file_, morph, node));
+  ++stats_.evictions;
+}
+
+bool SpillFile::PageIn(const std::string& morph, MorphNode* node) {
+  std::string key;
+  auto range = index_.equal_range(hash_(morph));
+  for (auto iter = range.first; iter != range.second; ++iter) {
+    // Different keys can share a hash, so check the key on disk.
+    Read(iter->second, &key, node);
+    if (key == morph) {
+      index_.erase(iter);
+      live_bytes_ -= RecordBytes(morph, *node);
+      ++stats_.page_ins;
+      return true;
+    }
+  }
+  return false;
+}
+
+void SpillFile::PageInAll(
+    const std::function<void(std::string, const MorphNode&)>& visit) {
+  std::string morph;
+  MorphNode node;
+  for (const auto& entry : index_) {
+    Read(entry.second, &morph, &node);
+    visit(morph, node);
+    ++stats_.page_ins;
+  }
+  index_.clear();
+  Truncate();
+}
+
+void SpillFile::ForEach(const std::function<void(const std::string&,
+    const MorphNode&)>& visit) const {
+  std::string morph;
+  MorphNode node;
+  for (const auto& entry : index_) {
+    Read(entry.second, &morph, &node);
+    visit(morph, node);
+  }
+}
+
+void SpillFile::Compact() {
+  if (file_bytes_ - live_bytes_ <= live_bytes_) {
+    return;
+  }
+
+  // Copy the live records one at a time, so that compacting does not need
+  // more memory than a single record.
+  auto compact_path = path_ + ".compact";
+  std::fstream compacted{compact_path, std::ios::in | std::ios::out
+      | std::ios::trunc | std::ios::binary};
+  assert(compacted.is_open());
+  file_bytes_ = 0;
+  live_bytes_ = 0;
+  std::string morph;
+  MorphNode node;
+  for (auto& entry : index_) {
+    Read(entry.second, &morph, &node);
+    entry.second = Write(compacted, morph, node);
+  }
+
+  compacted.close();
+  file_.close();
+  std::rename(compact_path.c_str(), path_.c_str());
+  file_.open(path_, std::ios::in | std::ios::out | std::ios::binary);
+  assert(file_.is_open());
+  ++stats_.compactions;
+}
+
+} // namespace morfessor
@@ -0,0 +1,89 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "tokenizer.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace morfessor {
+
+namespace {
+
+#ifdef __SSE2__
+/// Returns a bit mask with bit i set if byte i of the block is a word byte.
+inline unsigned WordByteMask(const char* block) noexcept {
+  auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+  // Bytes >= 0x80 have their sign bit set.
+  unsigned high = _mm_movemask_epi8(bytes);
+  // Fold to lower case and test 'a' <= c <= 'z' with one signed compare by
+  // shifting 'a' down to -128.
+  auto lower = _mm_or_si128(bytes, _mm_set1_epi8(0x20));
+  auto shifted = _mm_add_epi8(lower, _mm_set1_epi8(0x80 - 'a'));
+  auto letters = _mm_cmplt_epi8(shifted, _mm_set1_epi8(-128 + 26));
+  return high | _mm_movemask_epi8(letters);
+}
+#endif
+
+}  // namespace
+
+size_t FindWordStart(const char* text, size_t pos, size_t size) noexcept {
+#ifdef __SSE2__
+  for (; pos + 16 <= size; pos += 16) {
+    auto mask = WordByteMask(text + pos);
+    if (mask != 0) {
+      return pos + __builtin_ctz(mask);
+    }
+  }
+#endif
+  while (pos < size && !is_word_byte(text[pos])) {
+    ++pos;
+  }
+  return pos;
+}
+
+size_t FindWordEnd(const char* text, size_t pos, size_t size) noexcept {
+  for (;;) {
+#ifdef __SSE2__
+    for (; pos + 16 <= size; pos += 16) {
+      auto mask = ~WordByteMask(text + pos) & 0xFFFF;
+      if (mask != 0) {
+        pos += __builtin_ctz(mask);
+        break;
+      }
+    }
+#endif
+    while (pos < size && is_word_byte(text[pos])) {
+      ++pos;
+    }
+    // Keep going through an apostrophe that joins two runs of letters.
+    if (pos + 1 < size && text[pos] == '\'' && pos > 0
+        && is_word_byte(text[pos - 1]) && is_word_byte(text[pos + 1])) {
+      ++pos;
+      continue;
+    }
+    return pos;
+  }
+}
+
+} // namespace morfessor
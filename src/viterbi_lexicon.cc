@@ -0,0 +1,247 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "viterbi_lexicon.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace morfessor {
+
+constexpr int ViterbiLexicon::kMissing;
+constexpr size_t ViterbiLexicon::kHotKeyBytes;
+constexpr size_t ViterbiLexicon::kPrefetchDistance;
+
+ViterbiLexicon::ViterbiLexicon(size_t total_morph_tokens,
+    unsigned steps_per_nat)
+    : slots_(16, Slot{0, 0}), mask_{15},
+      total_morph_tokens_{total_morph_tokens},
+      log_token_count_{std::log(total_morph_tokens)},
+      steps_per_nat_{steps_per_nat} {
+  assert(steps_per_nat > 0);
+  assert(steps_per_nat * log_token_count_
+      <= std::numeric_limits<uint16_t>::max());
+}
+
+void ViterbiLexicon::Add(const std::string& morph, size_t count) {
+  assert(count > 0 && !morph.empty());
+  assert(morph.size() <= std::numeric_limits<uint16_t>::max());
+  assert(Find(morph) == kMissing);
+
+  entries_.push_back(Entry{static_cast<uint32_t>(text_.size()),
+      static_cast<uint16_t>(morph.size()), Cost(count)});
+  counts_.push_back(count);
+  text_ += morph;
+  max_length_ = std::max(max_length_, morph.size());
+
+  // Keep the table at most half full, counting removed entries, which
+  // keep their slots.
+  auto entries = hot_size_ + entries_.size();
+  if (entries * 2 > slots_.size()) {
+    Rehash(slots_.size() * 2);
+  } else {
+    Insert(Hash(morph.data(), morph.size()), entries);
+  }
+}
+
+void ViterbiLexicon::SetCount(const std::string& morph, size_t count) {
+  assert(!morph.empty());
+  auto index = Locate(morph);
+  if (index == static_cast<size_t>(-1)) {
+    if (count > 0) {
+      Add(morph, count);
+    }
+    return;
+  }
+  counts_[index] = count;
+  if (count > 0) {
+    SetCost(index, Cost(count));
+  } else {
+    SetLength(index, 0);
+    ++removed_;
+  }
+}
+
+void ViterbiLexicon::SetTotal(size_t total_morph_tokens) {
+  total_morph_tokens_ = total_morph_tokens;
+  log_token_count_ = std::log(total_morph_tokens);
+  assert(steps_per_nat_ * log_token_count_
+      <= std::numeric_limits<uint16_t>::max());
+  for (size_t i = 0; i < counts_.size(); ++i) {
+    if (counts_[i] > 0) {
+      SetCost(i, Cost(counts_[i]));
+    }
+  }
+}
+
+void ViterbiLexicon::ForEach(
+    const std::function<void(const std::string&, size_t)>& visit) const {
+  std::string morph;
+  for (size_t i = 0; i < counts_.size(); ++i) {
+    if (counts_[i] > 0) {
+      morph.assign(key(i), length(i));
+      visit(morph, counts_[i]);
+    }
+  }
+}
+
+void ViterbiLexicon::Reorder(size_t hot_morphs) {
+  assert(hot_size_ == 0);
+  std::vector<size_t> order;
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    if (counts_[i] > 0) {
+      order.push_back(i);
+    }
+  }
+  std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+    return counts_[a] > counts_[b];
+  });
+
+  std::string text;
+  std::vector<Entry> entries;
+  std::vector<size_t> hot_counts;
+  std::vector<size_t> counts;
+  text.reserve(text_.size());
+  entries.reserve(entries_.size());
+  counts.reserve(counts_.size());
+  for (auto index : order) {
+    const auto& entry = entries_[index];
+    if (hot_.size() < hot_morphs && entry.length <= kHotKeyBytes) {
+      HotEntry hot{};
+      hot.cost = entry.cost;
+      hot.length = static_cast<uint8_t>(entry.length);
+      text_.copy(hot.key, entry.length, entry.offset);
+      hot_.push_back(hot);
+      hot_counts.push_back(counts_[index]);
+      continue;
+    }
+    entries.push_back(Entry{static_cast<uint32_t>(text.size()),
+        entry.length, entry.cost});
+    text.append(text_, entry.offset, entry.length);
+    counts.push_back(counts_[index]);
+  }
+  text_ = std::move(text);
+  entries_ = std::move(entries);
+  counts_ = std::move(hot_counts);
+  counts_.insert(counts_.end(), counts.begin(), counts.end());
+  hot_size_ = hot_.size();
+  removed_ = 0;
+  Rehash(slots_.size());
+}
+
+void ViterbiLexicon::FindBatch(const Probe* probes, size_t count,
+    int* costs, LexiconTierStats* stats) const {
+  auto first_slot = [this](uint64_t hash) {
+    return (hash ^ (hash >> 32)) & mask_;
+  };
+  // Keep the first slot of the next kPrefetchDistance probes on its way
+  // while resolving the current one. Nearly every probe ends at its first
+  // slot, on an empty one or on the morph.
+  for (size_t i = 0; i < std::min(count, kPrefetchDistance); ++i) {
+    __builtin_prefetch(&slots_[first_slot(probes[i].hash)]);
+  }
+  for (size_t i = 0; i < count; ++i) {
+    if (i + kPrefetchDistance < count) {
+      __builtin_prefetch(
+          &slots_[first_slot(probes[i + kPrefetchDistance].hash)]);
+    }
+    costs[i] = Find(probes[i].morph, probes[i].length, probes[i].hash,
+        stats);
+  }
+}
+
+const char* ViterbiLexicon::key(size_t index) const noexcept {
+  return index < hot_size_ ? hot_[index].key
+      : text_.data() + entries_[index - hot_size_].offset;
+}
+
+size_t ViterbiLexicon::length(size_t index) const noexcept {
+  return index < hot_size_ ? hot_[index].length
+      : entries_[index - hot_size_].length;
+}
+
+size_t ViterbiLexicon::bytes() const noexcept {
+  return text_.capacity() + entries_.capacity() * sizeof(Entry)
+      + counts_.capacity() * sizeof(size_t)
+      + slots_.capacity() * sizeof(Slot)
+      + hot_.capacity() * sizeof(HotEntry);
+}
+
+size_t ViterbiLexicon::Locate(const std::string& morph) const {
+  auto hash = Hash(morph.data(), morph.size());
+  auto tag = static_cast<uint32_t>(hash >> 32);
+  for (auto i = (hash ^ tag) & mask_; slots_[i].entry != 0;
+      i = (i + 1) & mask_) {
+    size_t index = slots_[i].entry - 1;
+    if (slots_[i].tag == tag && length(index) == morph.size()
+        && std::memcmp(key(index), morph.data(), morph.size()) == 0) {
+      return index;
+    }
+  }
+  return static_cast<size_t>(-1);
+}
+
+uint16_t ViterbiLexicon::Cost(size_t count) const {
+  // With one step per nat, the same arithmetic as ViterbiSplit, which
+  // keeps whole numbers.
+  return static_cast<uint16_t>(
+      steps_per_nat_ * (log_token_count_ - std::log(count)));
+}
+
+void ViterbiLexicon::SetCost(size_t index, uint16_t cost) {
+  if (index < hot_size_) {
+    hot_[index].cost = cost;
+  } else {
+    entries_[index - hot_size_].cost = cost;
+  }
+}
+
+void ViterbiLexicon::SetLength(size_t index, size_t length) {
+  if (index < hot_size_) {
+    hot_[index].length = static_cast<uint8_t>(length);
+  } else {
+    entries_[index - hot_size_].length = static_cast<uint16_t>(length);
+  }
+}
+
+void ViterbiLexicon::Rehash(size_t slots) {
+  slots_.assign(slots, Slot{0, 0});
+  mask_ = slots - 1;
+  for (size_t i = 0; i < counts_.size(); ++i) {
+    if (counts_[i] > 0) {
+      Insert(Hash(key(i), length(i)), i + 1);
+    }
+  }
+}
+
+void ViterbiLexicon::Insert(uint64_t hash, uint32_t entry) {
+  auto tag = static_cast<uint32_t>(hash >> 32);
+  auto i = (hash ^ tag) & mask_;
+  while (slots_[i].entry != 0) {
+    i = (i + 1) & mask_;
+  }
+  slots_[i] = Slot{tag, entry};
+}
+
+}  // namespace morfessor
@@ -0,0 +1,223 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "word_counter.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#include "morph.h"
+#include "tokenizer.h"
+
+namespace morfessor {
+
+namespace {
+
+/// Rough size of a hash map entry holding a short word, used to account for
+/// the memory of the exact counts.
+constexpr size_t kEntryBytes = 64;
+
+/// Rough size of a hash set entry holding a 64 bit hash.
+constexpr size_t kHashEntryBytes = 32;
+
+/// Derives a second, independent-looking hash from the first, so that the
+/// rows of the sketch can be spread with double hashing.
+inline size_t Remix(size_t hash) noexcept {
+  uint64_t x = hash;
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ULL;
+  x ^= x >> 33;
+  return static_cast<size_t>(x) | 1;
+}
+
+/// Calls visit(word) for each word of the file, in lower case.
+template <class Visit>
+void ForEachWord(const std::string& text_file, Visit visit) {
+  std::ifstream text{text_file, std::ios::binary};
+  assert(text.is_open());
+  std::string word;
+  Tokenize(text, [](const char*, size_t) {},
+      [&](const char* letters, size_t length) {
+        word.assign(letters, length);
+        for (auto& c : word) {
+          if (c >= 'A' && c <= 'Z') {
+            c += 'a' - 'A';
+          }
+        }
+        visit(word);
+      });
+}
+
+Corpus CountExactly(const std::string& text_file, WordCountStats* stats) {
+  std::unordered_map<std::string, size_t> counts;
+  size_t tokens = 0;
+  ForEachWord(text_file, [&](const std::string& word) {
+    ++counts[word];
+    ++tokens;
+  });
+
+  std::vector<Morph> words;
+  words.reserve(counts.size());
+  for (const auto& count : counts) {
+    words.emplace_back(count.first, count.second);
+  }
+  if (stats != nullptr) {
+    stats->tokens = tokens;
+    stats->heavy_words = words.size();
+    stats->peak_heavy_words = words.size();
+    stats->tail_words = 0;
+    stats->counting_bytes = counts.size() * kEntryBytes
+        + counts.bucket_count() * sizeof(void*);
+    stats->error_bound = 0;
+  }
+  return Corpus{std::move(words)};
+}
+
+} // namespace
+
+CountMinSketch::CountMinSketch(size_t width, size_t depth)
+    : width_{width}, depth_{depth}, counters_(width * depth, 0) {
+  assert(width > 0 && depth > 0);
+}
+
+size_t CountMinSketch::index(size_t hash, size_t row) const noexcept {
+  return row * width_ + (hash + row * Remix(hash)) % width_;
+}
+
+void CountMinSketch::Add(size_t hash) noexcept {
+  auto estimate = Estimate(hash);
+  if (estimate == std::numeric_limits<uint32_t>::max()) {
+    return;
+  }
+  for (size_t row = 0; row < depth_; ++row) {
+    auto& counter = counters_[index(hash, row)];
+    if (counter == estimate) {
+      ++counter;
+    }
+  }
+}
+
+uint32_t CountMinSketch::Estimate(size_t hash) const noexcept {
+  auto estimate = std::numeric_limits<uint32_t>::max();
+  for (size_t row = 0; row < depth_; ++row) {
+    estimate = std::min(estimate, counters_[index(hash, row)]);
+  }
+  return estimate;
+}
+
+Corpus CountWords(const std::string& text_file,
+    const WordCountOptions& options, WordCountStats* stats) {
+  if (options.sketch_width == 0) {
+    return CountExactly(text_file, stats);
+  }
+
+  CountMinSketch sketch{options.sketch_width, options.sketch_depth};
+  std::hash<std::string> hasher;
+  auto capacity = std::max<size_t>(options.heavy_hitters, 1);
+
+  // First pass: fill the sketch, and keep the words whose estimate reaches
+  // the admission count. When the table grows to twice its capacity, it is
+  // cut back to the capacity words with the highest estimates, ties broken
+  // arbitrarily, and the admission count is raised to the lowest of them.
+  // Each cut follows at least capacity inserts, so it is amortized.
+  std::unordered_map<std::string, size_t> heavy;
+  using HeavyEntry = std::pair<uint32_t,
+      std::unordered_map<std::string, size_t>::iterator>;
+  std::vector<HeavyEntry> estimates;
+  uint32_t admit = 1;
+  size_t tokens = 0;
+  size_t max_heavy = 0;
+  ForEachWord(text_file, [&](const std::string& word) {
+    auto hash = hasher(word);
+    sketch.Add(hash);
+    ++tokens;
+    if (sketch.Estimate(hash) < admit || heavy.count(word) > 0) {
+      return;
+    }
+    heavy.emplace(word, 0);
+    if (heavy.size() <= 2 * capacity) {
+      return;
+    }
+    max_heavy = std::max(max_heavy, heavy.size());
+    estimates.clear();
+    for (auto iter = heavy.begin(); iter != heavy.end(); ++iter) {
+      estimates.emplace_back(sketch.Estimate(hasher(iter->first)), iter);
+    }
+    std::nth_element(estimates.begin(), estimates.begin() + capacity - 1,
+        estimates.end(), [](const HeavyEntry& a, const HeavyEntry& b) {
+          return a.first > b.first;
+        });
+    admit = std::max(admit, estimates[capacity - 1].first);
+    for (auto entry = estimates.begin() + capacity; entry != estimates.end();
+        ++entry) {
+      heavy.erase(entry->second);
+    }
+  });
+  max_heavy = std::max(max_heavy, heavy.size());
+
+  // Second pass: count the kept words exactly, and list every other word
+  // once with its sketch estimate. Tail words are told apart by their 64 bit
+  // hash, which for any realistic vocabulary is as good as the word itself
+  // and takes a fraction of the space.
+  static_assert(sizeof(size_t) == sizeof(uint64_t), "64 bit hashes");
+  std::unordered_set<uint64_t> listed;
+  std::vector<Morph> words;
+  ForEachWord(text_file, [&](const std::string& word) {
+    auto entry = heavy.find(word);
+    if (entry != heavy.end()) {
+      ++entry->second;
+      return;
+    }
+    auto hash = hasher(word);
+    if (listed.insert(hash).second) {
+      words.emplace_back(word, sketch.Estimate(hash));
+    }
+  });
+
+  auto tail_words = words.size();
+  for (const auto& entry : heavy) {
+    words.emplace_back(entry.first, entry.second);
+  }
+
+  if (stats != nullptr) {
+    stats->tokens = tokens;
+    stats->heavy_words = heavy.size();
+    stats->peak_heavy_words = max_heavy;
+    stats->tail_words = tail_words;
+    stats->counting_bytes = sketch.bytes() + max_heavy * kEntryBytes
+        + listed.size() * kHashEntryBytes
+        + listed.bucket_count() * sizeof(void*);
+    stats->error_bound = std::exp(1.0) / sketch.width() * tokens;
+  }
+  return Corpus{std::move(words)};
+}
+
+} // namespace morfessor
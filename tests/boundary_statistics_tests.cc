@@ -0,0 +1,62 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "boundary_statistics.h"
+
+#include <gtest/gtest.h>
+
+#include "corpus.h"
+#include "corpus_loader.h"
+
+using BoundaryStatistics = morfessor::BoundaryStatistics;
+using Corpus = morfessor::Corpus;
+using morfessor::tests::make_corpus;
+
+// Five stems, each with and without the same five endings.
+static const char* kWords =
+    "1 walk\n1 walked\n1 walking\n1 walks\n1 walker\n1 walkable\n"
+    "1 talk\n1 talked\n1 talking\n1 talks\n1 talker\n1 talkable\n"
+    "1 jump\n1 jumped\n1 jumping\n1 jumps\n1 jumper\n1 jumpable\n"
+    "1 kick\n1 kicked\n1 kicking\n1 kicks\n1 kicker\n1 kickable\n"
+    "1 print\n1 printed\n1 printing\n1 prints\n1 printer\n1 printable\n";
+
+TEST(BoundaryStatisticsTests, ScoresStemBoundaryHighest)
+{
+  auto corpus = make_corpus(kWords);
+  BoundaryStatistics statistics{corpus, 2};
+
+  // "walking" is the third word.
+  auto best = statistics.score(2, 4);
+  EXPECT_GT(best, 0);
+  for (size_t position = 1; position < 7; ++position) {
+    if (position != 4) {
+      EXPECT_LT(statistics.score(2, position), best) << position;
+    }
+  }
+}
+
+TEST(BoundaryStatisticsTests, IgnoresRareContexts)
+{
+  auto corpus = make_corpus(kWords);
+  BoundaryStatistics statistics{corpus, 100};
+  EXPECT_EQ(0, statistics.score(2, 4));
+}
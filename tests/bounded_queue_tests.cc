@@ -0,0 +1,66 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "bounded_queue.h"
+
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using IntQueue = morfessor::BoundedQueue<int>;
+
+TEST(BoundedQueueTests, PopsInOrderAcrossThreads)
+{
+  IntQueue queue{2};
+  std::thread producer{[&queue] {
+    for (int i = 0; i < 1000; ++i) {
+      queue.Push(i);
+    }
+    queue.Close();
+  }};
+
+  std::vector<int> popped;
+  int item;
+  while (queue.Pop(&item)) {
+    popped.push_back(item);
+  }
+  producer.join();
+
+  ASSERT_EQ(1000, popped.size());
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_EQ(i, popped[i]);
+  }
+}
+
+TEST(BoundedQueueTests, DrainsItemsBeforeReportingClosed)
+{
+  IntQueue queue{4};
+  queue.Push(7);
+  queue.Close();
+
+  int item = 0;
+  EXPECT_TRUE(queue.Pop(&item));
+  EXPECT_EQ(7, item);
+  EXPECT_FALSE(queue.Pop(&item));
+  EXPECT_EQ(7, item);
+}
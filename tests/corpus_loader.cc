@@ -22,6 +22,11 @@
 
 #include "corpus_loader.h"
 
+#include <sstream>
+
+#include "model.h"
+#include "segmentation.h"
+
 namespace morfessor {
 
 namespace tests {
@@ -31,6 +36,20 @@ CorpusLoader& corpus_loader() {
   return cl;
 }
 
+Corpus make_corpus(const std::string& lines) {
+  std::stringstream in{lines};
+  return Corpus{in};
+}
+
+std::unique_ptr<Segmentation> make_frozen(const std::string& lines,
+    size_t hot_morphs) {
+  auto lexicon = make_corpus(lines);
+  auto segmentation = std::make_unique<Segmentation>(lexicon,
+      std::make_shared<BaselineModel>(lexicon));
+  segmentation->Freeze(hot_morphs);
+  return segmentation;
+}
+
 }  // namespace tests
 
 }  // namespace morfessor
@@ -23,10 +23,16 @@
 #ifndef TESTS_CORPUS_LOADER_H_
 #define TESTS_CORPUS_LOADER_H_
 
+#include <cstddef>
+#include <memory>
+#include <string>
+
 #include "corpus.h"
 
 namespace morfessor {
 
+class Segmentation;
+
 namespace tests {
 
 struct CorpusLoader {
@@ -45,6 +51,14 @@ struct CorpusLoader {
 
 CorpusLoader& corpus_loader();
 
+/// Reads a word list or model from a string, the way Corpus reads a file.
+Corpus make_corpus(const std::string& lines);
+
+/// Builds a model from morph lines, the way --load does, and freezes it
+/// with the given number of hot morphs.
+std::unique_ptr<Segmentation> make_frozen(const std::string& lines,
+    size_t hot_morphs = 0);
+
 }  // namespace tests
 
 }  // namespace morfessor
@@ -22,6 +22,10 @@
 
 #include "corpus.h"
 
+#include <sstream>
+#include <string>
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include "morph.h"
@@ -94,3 +98,90 @@ TEST(CorpusTests, CorpusIterate)
 	++iter;
 	EXPECT_EQ(corpus.cend(), iter);
 }
+
+TEST(CorpusTests, ParseLinesMatchesParseLine)
+{
+	// The shapes ParseLines reads itself, and the ones it hands to
+	// ParseLine, with a word that runs over a 64 byte block.
+	std::vector<std::string> lines{"548 abandon", "Overall cost: 12.5",
+		"  7\tdeck  ", "3 ran\r", "", "\t", "12", "12 ", "+5 plus",
+		"-5 minus", "5x word", "x5 word", "00012 zeros",
+		"18446744073709551615 most", "123456789012 big", "9 two words",
+		"4 " + std::string(100, 'w'), "8 \xc3\xa4iti"};
+	std::string text;
+	std::vector<morfessor::Morph> expected;
+	for (size_t repeat = 0; repeat < 5; ++repeat) {
+		for (const auto& line : lines) {
+			text += line + "\n";
+			expected.push_back(Corpus::ParseLine(line));
+		}
+	}
+	text += "6 last";
+	expected.push_back(Corpus::ParseLine("6 last"));
+
+	for (auto level : {morfessor::ScanLevel::kScalar,
+			morfessor::SupportedScanLevel()}) {
+		std::vector<morfessor::Morph> words;
+		EXPECT_EQ(text.size(),
+			Corpus::ParseLines(text.data(), text.size(), true, &words, level));
+		ASSERT_EQ(expected.size(), words.size());
+		for (size_t i = 0; i < expected.size(); ++i) {
+			EXPECT_EQ(expected[i].letters(), words[i].letters()) << i;
+			EXPECT_EQ(expected[i].frequency(), words[i].frequency()) << i;
+		}
+
+		// Without the end of the list, the last line may go on.
+		words.clear();
+		EXPECT_EQ(text.size() - 6,
+			Corpus::ParseLines(text.data(), text.size(), false, &words, level));
+		EXPECT_EQ(expected.size() - 1, words.size());
+	}
+}
+
+TEST(CorpusTests, BlankLinesHaveNoWordAndNoCount)
+{
+	for (const std::string line : {"", " ", "\t\r", "  \v\f "}) {
+		EXPECT_EQ("", Corpus::ParseLine(line).letters());
+		EXPECT_EQ(0u, Corpus::ParseLine(line).frequency());
+		std::vector<morfessor::Morph> words;
+		auto text = line + "\n";
+		Corpus::ParseLines(text.data(), text.size(), true, &words);
+		ASSERT_EQ(1u, words.size());
+		EXPECT_EQ("", words[0].letters());
+		EXPECT_EQ(0u, words[0].frequency());
+	}
+}
+
+TEST(CorpusTests, ReadsLinesAcrossChunks)
+{
+	// More than one chunk of 1 MiB, so that lines are carried over.
+	std::stringstream in;
+	for (size_t i = 0; i < 150000; ++i) {
+		in << i << " word" << i << "\n";
+	}
+	Corpus corpus{in};
+	ASSERT_EQ(150000u, corpus.size());
+	size_t i = 0;
+	for (auto iter = corpus.cbegin(); iter != corpus.cend(); ++iter, ++i) {
+		ASSERT_EQ(i, iter->frequency());
+		ASSERT_EQ("word" + std::to_string(i), iter->letters());
+	}
+}
+
+TEST(CorpusTests, ReadsLinesLongerThanAChunk)
+{
+	// No line ends in the first chunk, so all of it is carried over.
+	std::string long_word(3 << 20, 'w');
+	std::stringstream in{"2 " + long_word + "\n3 x\n"};
+	std::vector<morfessor::Morph> words;
+	size_t calls = 0;
+	Corpus::ParseStream(in, [&](std::vector<morfessor::Morph>* parsed) {
+		++calls;
+		words.insert(words.end(), parsed->begin(), parsed->end());
+	});
+	EXPECT_EQ(1u, calls);
+	ASSERT_EQ(2u, words.size());
+	EXPECT_EQ(long_word, words[0].letters());
+	EXPECT_EQ(2u, words[0].frequency());
+	EXPECT_EQ("x", words[1].letters());
+}
@@ -0,0 +1,302 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Differential tests: each optimized engine is run next to the reference
+// serial path on the same input and shuffle seed, in all four algorithm
+// modes. Engines that promise the same result must produce the same leaf
+// lexicon; the others must stay within the tolerances below.
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "boundary_statistics.h"
+#include "corpus.h"
+#include "corpus_loader.h"
+#include "model.h"
+#include "segmentation.h"
+#include "segmentation_cache.h"
+#include "tokenizer.h"
+#include "types.h"
+
+using AlgorithmModes = morfessor::AlgorithmModes;
+using Corpus = morfessor::Corpus;
+using Model = morfessor::Model;
+using Segmentation = morfessor::Segmentation;
+static auto corpus_loader = &morfessor::tests::corpus_loader;
+
+namespace {
+
+const AlgorithmModes kModes[] = {
+  AlgorithmModes::kBaseline,
+  AlgorithmModes::kBaselineFreq,
+  AlgorithmModes::kBaselineLength,
+  AlgorithmModes::kBaselineFreqLength
+};
+
+const unsigned kSeeds[] = {1, 2, 3};
+
+/// Most that the final cost of an approximate engine may differ from the
+/// reference, relative to the reference cost.
+constexpr double kCostTolerance = 0.01;
+
+/// Least boundary F-measure of an approximate engine's segmentation of the
+/// training words, taking the reference segmentation as correct.
+constexpr double kMinBoundaryFMeasure = 0.8;
+
+/// A trained model and the segmentation that goes with it.
+struct Trained {
+  std::shared_ptr<Model> model;
+  std::unique_ptr<Segmentation> segmentation;
+};
+
+std::shared_ptr<Model> make_model(const Corpus& corpus, AlgorithmModes mode) {
+  return std::make_shared<Model>(corpus, mode, 0.5, 7.0, 1.0);
+}
+
+/// The reference engine: in memory, unseeded, one word at a time.
+Trained train_reference(const Corpus& corpus, AlgorithmModes mode,
+    unsigned seed) {
+  Trained trained;
+  trained.model = make_model(corpus, mode);
+  trained.segmentation.reset(new Segmentation(corpus, trained.model));
+  trained.segmentation->set_seed(seed);
+  trained.segmentation->Optimize(corpus);
+  return trained;
+}
+
+/// The batched engine, with the given number of threads.
+Trained train_batched(const Corpus& corpus, AlgorithmModes mode,
+    unsigned seed, size_t threads) {
+  Trained trained;
+  trained.model = make_model(corpus, mode);
+  trained.segmentation.reset(new Segmentation(corpus, trained.model));
+  trained.segmentation->set_seed(seed);
+  trained.segmentation->set_threads(threads, 32);
+  trained.segmentation->Optimize(corpus);
+  return trained;
+}
+
+/// The leaf morphs of a segmentation and their counts.
+std::map<std::string, size_t> leaf_lexicon(const Segmentation& segmentation) {
+  std::stringstream lines;
+  segmentation.print_as_corpus(lines);
+  std::map<std::string, size_t> lexicon;
+  size_t count;
+  std::string morph;
+  while (lines >> count >> morph) {
+    lexicon[morph] += count;
+  }
+  return lexicon;
+}
+
+/// Splits each training word with the segmentation.
+std::vector<std::string> segment_words(const Segmentation& segmentation,
+    const Corpus& corpus) {
+  std::vector<std::string> segments;
+  for (auto iter = corpus.cbegin(); iter != corpus.cend(); ++iter) {
+    segments.push_back(segmentation.SegmentWord(iter->letters()));
+  }
+  return segments;
+}
+
+/// Boundary F-measure of the candidate segmentations against the reference
+/// ones, in the "morph morph " format of SegmentWord.
+double boundary_f_measure(const std::vector<std::string>& reference,
+    const std::vector<std::string>& candidate) {
+  auto boundaries = [](const std::string& segments) {
+    std::vector<size_t> positions;
+    size_t letters = 0;
+    for (size_t i = 0; i + 1 < segments.size(); ++i) {
+      if (segments[i] == ' ') {
+        positions.push_back(letters);
+      } else {
+        ++letters;
+      }
+    }
+    return positions;
+  };
+
+  size_t hits = 0;
+  size_t reference_total = 0;
+  size_t candidate_total = 0;
+  for (size_t i = 0; i < reference.size(); ++i) {
+    auto expected = boundaries(reference[i]);
+    auto found = boundaries(candidate[i]);
+    reference_total += expected.size();
+    candidate_total += found.size();
+    for (auto position : found) {
+      if (std::find(expected.begin(), expected.end(), position)
+          != expected.end()) {
+        ++hits;
+      }
+    }
+  }
+  if (reference_total == 0 && candidate_total == 0) {
+    return 1.0;
+  }
+  if (hits == 0) {
+    return 0.0;
+  }
+  double precision = static_cast<double>(hits) / candidate_total;
+  double recall = static_cast<double>(hits) / reference_total;
+  return 2 * precision * recall / (precision + recall);
+}
+
+/// Checks an engine that promises exactly the reference result.
+void expect_identical(const Corpus& corpus, const Trained& reference,
+    const Trained& candidate) {
+  EXPECT_EQ(leaf_lexicon(*reference.segmentation),
+      leaf_lexicon(*candidate.segmentation));
+  EXPECT_DOUBLE_EQ(reference.model->overall_cost(),
+      candidate.model->overall_cost());
+  EXPECT_EQ(segment_words(*reference.segmentation, corpus),
+      segment_words(*candidate.segmentation, corpus));
+}
+
+/// Checks an engine that promises a result close to the reference.
+void expect_close(const Corpus& corpus, const Trained& reference,
+    const Trained& candidate) {
+  auto reference_cost = reference.model->overall_cost();
+  EXPECT_NEAR(reference_cost, candidate.model->overall_cost(),
+      kCostTolerance * reference_cost);
+  EXPECT_GE(boundary_f_measure(segment_words(*reference.segmentation, corpus),
+      segment_words(*candidate.segmentation, corpus)), kMinBoundaryFMeasure);
+}
+
+}  // namespace
+
+TEST(DifferentialTests, ReferenceIsRepeatable) {
+  const Corpus& corpus = corpus_loader().corpus3;
+  for (auto mode : kModes) {
+    SCOPED_TRACE(static_cast<unsigned>(mode));
+    expect_identical(corpus, train_reference(corpus, mode, 1),
+        train_reference(corpus, mode, 1));
+  }
+}
+
+TEST(DifferentialTests, SpillingMatchesReference) {
+  const Corpus& corpus = corpus_loader().corpus3;
+  for (auto mode : kModes) {
+    for (auto seed : kSeeds) {
+      SCOPED_TRACE(static_cast<unsigned>(mode));
+      SCOPED_TRACE(seed);
+      Trained candidate;
+      candidate.model = make_model(corpus, mode);
+      candidate.segmentation.reset(new Segmentation(corpus, candidate.model,
+          "differential_tests.spill", 16));
+      candidate.segmentation->set_seed(seed);
+      candidate.segmentation->Optimize(corpus);
+      // Viterbi only sees nodes in memory.
+      candidate.segmentation->Unspill();
+      expect_identical(corpus, train_reference(corpus, mode, seed),
+          candidate);
+    }
+  }
+}
+
+TEST(DifferentialTests, SeededSplitsCloseToReference) {
+  const Corpus& corpus = corpus_loader().corpus3;
+  morfessor::BoundaryStatistics statistics{corpus, 2};
+  for (auto mode : kModes) {
+    for (auto seed : kSeeds) {
+      SCOPED_TRACE(static_cast<unsigned>(mode));
+      SCOPED_TRACE(seed);
+      Trained candidate;
+      candidate.model = make_model(corpus, mode);
+      candidate.segmentation.reset(new Segmentation(corpus, candidate.model));
+      candidate.segmentation->SeedSplits(corpus, statistics, 0.5);
+      candidate.segmentation->set_seed(seed);
+      candidate.segmentation->Optimize(corpus);
+      expect_close(corpus, train_reference(corpus, mode, seed), candidate);
+    }
+  }
+}
+
+TEST(DifferentialTests, BatchedIsIndependentOfThreadCount) {
+  const Corpus& corpus = corpus_loader().corpus3;
+  for (auto mode : kModes) {
+    for (auto seed : kSeeds) {
+      SCOPED_TRACE(static_cast<unsigned>(mode));
+      SCOPED_TRACE(seed);
+      auto single = train_batched(corpus, mode, seed, 1);
+      expect_identical(corpus, single, train_batched(corpus, mode, seed, 2));
+      expect_identical(corpus, single, train_batched(corpus, mode, seed, 5));
+      expect_close(corpus, train_reference(corpus, mode, seed), single);
+    }
+  }
+}
+
+TEST(DifferentialTests, SegmentationPathsAgree) {
+  const Corpus& corpus = corpus_loader().corpus3;
+  for (auto mode : kModes) {
+    SCOPED_TRACE(static_cast<unsigned>(mode));
+    auto reference = train_reference(corpus, mode, 1);
+    auto& segmentation = *reference.segmentation;
+    auto expected = segment_words(segmentation, corpus);
+
+    EXPECT_EQ(expected, *segmentation.SegmentTestCorpus(corpus));
+    auto batch = expected;
+    for (size_t i = 0; i < batch.size(); ++i) {
+      batch[i] = (corpus.cbegin() + i)->letters();
+    }
+    segmentation.SegmentBatch(&batch);
+    EXPECT_EQ(expected, batch);
+
+    // So does the frozen copy of the lexicon.
+    segmentation.Freeze();
+    EXPECT_EQ(expected, *segmentation.SegmentTestCorpus(corpus));
+
+    // A cache that is up to date is used as is.
+    std::stringstream cached_lines;
+    for (const auto& segments : expected) {
+      cached_lines << segments << "\n";
+    }
+    morfessor::SegmentationCache cache{cached_lines};
+    EXPECT_EQ(expected, *segmentation.SegmentTestCorpus(corpus, cache));
+
+    // Running text gets the same splits, with a different separator, for
+    // the words that the tokenizer reads as one word.
+    std::stringstream text;
+    std::string expected_text;
+    auto segments = expected.cbegin();
+    for (auto iter = corpus.cbegin(); iter != corpus.cend();
+        ++iter, ++segments) {
+      const auto& word = iter->letters();
+      if (morfessor::FindWordEnd(word.data(), 0, word.size()) != word.size()) {
+        continue;
+      }
+      text << word << "\n";
+      auto line = segments->substr(0, segments->size() - 1);
+      std::replace(line.begin(), line.end(), ' ', '+');
+      expected_text += line + "\n";
+    }
+    std::stringstream segmented_text;
+    segmentation.SegmentText(text, segmented_text, "+");
+    EXPECT_EQ(expected_text, segmented_text.str());
+  }
+}
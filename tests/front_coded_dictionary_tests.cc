@@ -0,0 +1,170 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "front_coded_dictionary.h"
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "morph.h"
+
+using FrontCodedDictionary = morfessor::FrontCodedDictionary;
+using Morph = morfessor::Morph;
+
+namespace {
+
+/// Words that share long prefixes, more than two blocks of them, given out
+/// of order.
+std::vector<Morph> TestEntries() {
+  std::vector<Morph> entries;
+  for (size_t i = 40; i > 0; --i) {
+    entries.emplace_back("walk" + std::string(i % 7, 'e') + std::to_string(i),
+        i);
+  }
+  entries.emplace_back("a", 1000);
+  entries.emplace_back("zebra", 3);
+  return entries;
+}
+
+}  // namespace
+
+TEST(FrontCodedDictionaryTests, FindsEveryEntryAndNothingElse)
+{
+  auto entries = TestEntries();
+  FrontCodedDictionary dictionary{entries};
+  EXPECT_EQ(entries.size(), dictionary.size());
+
+  for (const auto& entry : entries) {
+    size_t count = 0;
+    EXPECT_TRUE(dictionary.Find(entry.letters(), &count)) << entry.letters();
+    EXPECT_EQ(entry.frequency(), count);
+  }
+  size_t count = 0;
+  for (const auto& missing : {"", "0", "b", "walk", "walke", "walk41",
+      "walkeee", "zebras", "zz"}) {
+    EXPECT_FALSE(dictionary.Find(missing, &count)) << missing;
+  }
+}
+
+TEST(FrontCodedDictionaryTests, VisitsEntriesInOrder)
+{
+  auto entries = TestEntries();
+  FrontCodedDictionary dictionary{entries};
+
+  std::vector<std::pair<std::string, size_t>> visited;
+  dictionary.ForEach([&visited](const std::string& letters, size_t count) {
+    visited.emplace_back(letters, count);
+  });
+  ASSERT_EQ(entries.size(), visited.size());
+  for (size_t i = 1; i < visited.size(); ++i) {
+    EXPECT_LT(visited[i - 1].first, visited[i].first);
+  }
+  EXPECT_EQ("a", visited.front().first);
+  EXPECT_EQ(1000u, visited.front().second);
+  EXPECT_EQ("zebra", visited.back().first);
+
+  // The shared prefixes are not stored again.
+  size_t letters = 0;
+  for (const auto& entry : entries) {
+    letters += entry.length();
+  }
+  EXPECT_LT(dictionary.bytes(), letters);
+}
+
+TEST(FrontCodedDictionaryTests, ReadsBackWhatItWrites)
+{
+  FrontCodedDictionary dictionary{TestEntries()};
+  std::stringstream stream;
+  dictionary.Write(stream);
+  FrontCodedDictionary copy{stream};
+
+  std::vector<std::pair<std::string, size_t>> expected;
+  std::vector<std::pair<std::string, size_t>> actual;
+  dictionary.ForEach([&expected](const std::string& letters, size_t count) {
+    expected.emplace_back(letters, count);
+  });
+  copy.ForEach([&actual](const std::string& letters, size_t count) {
+    actual.emplace_back(letters, count);
+  });
+  EXPECT_EQ(expected, actual);
+  EXPECT_EQ(dictionary.bytes(), copy.bytes());
+}
+
+TEST(FrontCodedDictionaryTests, EmptyDictionary)
+{
+  FrontCodedDictionary dictionary{std::vector<Morph>{}};
+  size_t count = 0;
+  EXPECT_FALSE(dictionary.Find("a", &count));
+  EXPECT_EQ(0u, dictionary.size());
+
+  std::stringstream stream;
+  dictionary.Write(stream);
+  FrontCodedDictionary copy{stream};
+  EXPECT_EQ(0u, copy.size());
+}
+
+TEST(FrontCodedDictionaryTests, RejectsCutOffData)
+{
+  std::stringstream stream;
+  FrontCodedDictionary{TestEntries()}.Write(stream);
+  auto written = stream.str();
+  for (auto length : {size_t{4}, size_t{20}, written.size() / 2,
+      written.size() - 1}) {
+    std::stringstream cut{written.substr(0, length)};
+    FrontCodedDictionary copy{cut};
+    EXPECT_TRUE(cut.fail()) << length;
+    EXPECT_EQ(0u, copy.size()) << length;
+  }
+}
+
+TEST(FrontCodedDictionaryTests, RejectsLengthsPastTheEndOfTheStream)
+{
+  std::stringstream stream;
+  FrontCodedDictionary{TestEntries()}.Write(stream);
+  auto written = stream.str();
+  // The byte count of the blocks follows the number of entries.
+  written[sizeof(uint64_t) + 7] = '\x7f';
+  std::stringstream corrupt{written};
+  FrontCodedDictionary copy{corrupt};
+  EXPECT_TRUE(corrupt.fail());
+  EXPECT_EQ(0u, copy.size());
+  EXPECT_EQ(0u, copy.bytes());
+}
+
+TEST(FrontCodedDictionaryTests, RejectsBlocksThatDoNotDecode)
+{
+  std::stringstream stream;
+  FrontCodedDictionary{TestEntries()}.Write(stream);
+  auto written = stream.str();
+  // The first entry starts with its length. A wrong one throws the rest of
+  // the block off, so it no longer ends where the next block starts.
+  written[2 * sizeof(uint64_t)] = '\x7f';
+  std::stringstream corrupt{written};
+  FrontCodedDictionary copy{corrupt};
+  EXPECT_TRUE(corrupt.fail());
+  EXPECT_EQ(0u, copy.size());
+}
@@ -0,0 +1,112 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "line_scanner.h"
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using morfessor::ParseCount;
+using morfessor::ScanBlocks;
+using morfessor::ScanLevel;
+
+/// The levels this CPU can run, which the others are compared against.
+static std::vector<ScanLevel> supported_levels() {
+  std::vector<ScanLevel> levels{ScanLevel::kScalar};
+  if (morfessor::SupportedScanLevel() != ScanLevel::kScalar) {
+    levels.push_back(ScanLevel::kSse2);
+  }
+  if (morfessor::SupportedScanLevel() == ScanLevel::kAvx2) {
+    levels.push_back(ScanLevel::kAvx2);
+  }
+  return levels;
+}
+
+TEST(LineScannerTests, FindsNewlinesAndBlanks)
+{
+  std::string text = "12 walk\r\n3\tran\v\f x";
+  text.resize(64, 'y');
+  for (auto level : supported_levels()) {
+    uint64_t newlines;
+    uint64_t blanks;
+    ScanBlocks(text.data(), 1, &newlines, &blanks, level);
+    EXPECT_EQ(1ULL << 8, newlines);
+    EXPECT_EQ((1ULL << 2) | (1ULL << 7) | (1ULL << 10) | (1ULL << 14)
+        | (1ULL << 15) | (1ULL << 16), blanks);
+  }
+}
+
+TEST(LineScannerTests, EveryLevelAgreesOnEveryByte)
+{
+  // Every byte value, and then random bytes, over a few blocks.
+  std::string text;
+  for (int c = 0; c < 256; ++c) {
+    text += static_cast<char>(c);
+  }
+  std::mt19937 random{7};
+  while (text.size() < 64 * 16) {
+    text += static_cast<char>(random());
+  }
+  std::vector<uint64_t> expected_newlines(16);
+  std::vector<uint64_t> expected_blanks(16);
+  ScanBlocks(text.data(), 16, expected_newlines.data(),
+      expected_blanks.data(), ScanLevel::kScalar);
+  for (auto level : supported_levels()) {
+    std::vector<uint64_t> newlines(16);
+    std::vector<uint64_t> blanks(16);
+    ScanBlocks(text.data(), 16, newlines.data(), blanks.data(), level);
+    EXPECT_EQ(expected_newlines, newlines);
+    EXPECT_EQ(expected_blanks, blanks);
+  }
+}
+
+TEST(LineScannerTests, ParsesCountsOfEveryLength)
+{
+  std::string digits = "1234567890123456789";
+  for (size_t length = 1; length <= digits.size(); ++length) {
+    auto text = digits.substr(0, length) + "        ";
+    size_t count = 0;
+    ASSERT_TRUE(ParseCount(text.data(), length, &count));
+    EXPECT_EQ(std::stoull(digits.substr(0, length)), count);
+  }
+  size_t count = 0;
+  EXPECT_TRUE(ParseCount("00000042", 8, &count));
+  EXPECT_EQ(42u, count);
+  EXPECT_TRUE(ParseCount("7 abcdefgh", 1, &count));
+  EXPECT_EQ(7u, count);
+}
+
+TEST(LineScannerTests, RejectsCountsThatAreNotDigits)
+{
+  size_t count = 0;
+  for (const std::string text : {"1a      ", "/1      ", ":1      ",
+      "1\xb9      ", "-5      ", "+5      "}) {
+    EXPECT_FALSE(ParseCount(text.data(), 2, &count)) << text;
+  }
+  EXPECT_FALSE(ParseCount("123456789012345678x", 19, &count));
+  EXPECT_FALSE(ParseCount("12345678901234567890", 20, &count));
+  EXPECT_FALSE(ParseCount("        ", 0, &count));
+}
@@ -0,0 +1,102 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "metrics.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+TEST(MetricsTests, WritesCountersAndLabelledGauges)
+{
+  morfessor::Metrics metrics;
+  metrics.DefineCounter("words_total", "Words segmented.");
+  metrics.DefineGauge("model_info", "The loaded model.",
+      {{"checksum", "ab"}});
+  metrics.Add("words_total", 3);
+  metrics.Add("words_total", 4);
+  metrics.Set("model_info", 1);
+
+  std::ostringstream out;
+  metrics.Write(out);
+  EXPECT_EQ("# HELP words_total Words segmented.\n"
+      "# TYPE words_total counter\n"
+      "words_total 7\n"
+      "# HELP model_info The loaded model.\n"
+      "# TYPE model_info gauge\n"
+      "model_info{checksum=\"ab\"} 1\n", out.str());
+}
+
+TEST(MetricsTests, EscapesLabelValues)
+{
+  morfessor::Metrics metrics;
+  metrics.DefineGauge("model_info", "The loaded model.",
+      {{"path", "a\\b\"c\nd"}, {"checksum", "ab"}});
+  metrics.Set("model_info", 1);
+
+  std::ostringstream out;
+  metrics.Write(out);
+  std::string expected =
+      "model_info{path=\"a\\\\b\\\"c\\nd\",checksum=\"ab\"} 1\n";
+  EXPECT_NE(std::string::npos, out.str().find(expected)) << out.str();
+}
+
+TEST(MetricsTests, HistogramBucketsAreCumulative)
+{
+  morfessor::Metrics metrics;
+  metrics.DefineHistogram("latency_seconds", "Latency.", {0.5, 1});
+  metrics.Observe("latency_seconds", 0.25);
+  metrics.Observe("latency_seconds", 0.75);
+  metrics.Observe("latency_seconds", 2);
+
+  std::ostringstream out;
+  metrics.Write(out);
+  auto text = out.str();
+  EXPECT_NE(std::string::npos,
+      text.find("latency_seconds_bucket{le=\"0.5\"} 1\n"));
+  EXPECT_NE(std::string::npos,
+      text.find("latency_seconds_bucket{le=\"1\"} 2\n"));
+  EXPECT_NE(std::string::npos,
+      text.find("latency_seconds_bucket{le=\"+Inf\"} 3\n"));
+  EXPECT_NE(std::string::npos, text.find("latency_seconds_sum 3\n"));
+  EXPECT_NE(std::string::npos, text.find("latency_seconds_count 3\n"));
+}
+
+TEST(MetricsTests, MetricsFileIsWrittenOnExit)
+{
+  const std::string path = "metrics_tests.prom";
+  morfessor::Metrics metrics;
+  metrics.DefineCounter("requests_total", "Requests.");
+  {
+    morfessor::MetricsFile file{path, &metrics, std::chrono::hours(1),
+        nullptr};
+    metrics.Add("requests_total", 2);
+  }
+  std::ifstream in{path};
+  std::stringstream text;
+  text << in.rdbuf();
+  EXPECT_NE(std::string::npos, text.str().find("requests_total 2\n"));
+  std::remove(path.c_str());
+}
@@ -0,0 +1,125 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "model_delta.h"
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "corpus.h"
+#include "corpus_loader.h"
+#include "lexicon_diff.h"
+#include "viterbi_lexicon.h"
+
+using Corpus = morfessor::Corpus;
+using ModelDelta = morfessor::ModelDelta;
+using ViterbiLexicon = morfessor::ViterbiLexicon;
+using morfessor::tests::make_corpus;
+
+static const char kOldModel[] =
+    "Overall cost: 1.0\n3 re\n5 do\n4 ing\n40 s\n";
+static const char kNewModel[] =
+    "Overall cost: 2.0\n3 re\n6 do\n2 er\n40 s\n";
+
+TEST(ModelDeltaTests, ListsChangedMorphsInOrder)
+{
+  ModelDelta delta{make_corpus(kOldModel), make_corpus(kNewModel)};
+  ASSERT_EQ(3u, delta.changes().size());
+  EXPECT_EQ("do", delta.changes()[0].morph);
+  EXPECT_EQ(5u, delta.changes()[0].old_count);
+  EXPECT_EQ(6u, delta.changes()[0].new_count);
+  EXPECT_EQ("er", delta.changes()[1].morph);
+  EXPECT_EQ(0u, delta.changes()[1].old_count);
+  EXPECT_EQ("ing", delta.changes()[2].morph);
+  EXPECT_EQ(0u, delta.changes()[2].new_count);
+  EXPECT_EQ(52u, delta.old_total());
+  EXPECT_EQ(51u, delta.new_total());
+  EXPECT_EQ(morfessor::LexiconChecksum(make_corpus(kOldModel)),
+      delta.old_checksum());
+  EXPECT_EQ(morfessor::LexiconChecksum(make_corpus(kNewModel)),
+      delta.new_checksum());
+}
+
+TEST(ModelDeltaTests, ReadsWhatItWrites)
+{
+  ModelDelta delta{make_corpus(kOldModel), make_corpus(kNewModel)};
+  std::stringstream file;
+  delta.Write(file);
+  ModelDelta read{file};
+
+  EXPECT_EQ(delta.old_total(), read.old_total());
+  EXPECT_EQ(delta.new_total(), read.new_total());
+  EXPECT_EQ(delta.old_checksum(), read.old_checksum());
+  EXPECT_EQ(delta.new_checksum(), read.new_checksum());
+  ASSERT_EQ(delta.changes().size(), read.changes().size());
+  for (size_t i = 0; i < delta.changes().size(); ++i) {
+    EXPECT_EQ(delta.changes()[i].morph, read.changes()[i].morph);
+    EXPECT_EQ(delta.changes()[i].old_count, read.changes()[i].old_count);
+    EXPECT_EQ(delta.changes()[i].new_count, read.changes()[i].new_count);
+  }
+}
+
+TEST(ModelDeltaTests, MakesTheNewModelFromTheOldOne)
+{
+  ModelDelta delta{make_corpus(kOldModel), make_corpus(kNewModel)};
+  std::vector<morfessor::Morph> patched;
+  ASSERT_TRUE(delta.Apply(make_corpus(kOldModel), &patched));
+  EXPECT_EQ(morfessor::LexiconChecksum(make_corpus(kNewModel)),
+      morfessor::LexiconChecksum(Corpus{patched}));
+
+  // Not the model it was made from.
+  EXPECT_FALSE(delta.Apply(make_corpus(kNewModel), &patched));
+  EXPECT_FALSE(delta.Apply(make_corpus("3 re\n5 do\n4 ing\n39 s\n"),
+      &patched));
+}
+
+TEST(ModelDeltaTests, PatchesAFrozenLexiconInPlace)
+{
+  auto freeze = [](const Corpus& model, ViterbiLexicon* lexicon) {
+    for (auto iter = model.cbegin(); iter != model.cend(); ++iter) {
+      if (!iter->letters().empty()) {
+        lexicon->Add(iter->letters(), iter->frequency());
+      }
+    }
+    lexicon->Reorder(2);
+  };
+  ModelDelta delta{make_corpus(kOldModel), make_corpus(kNewModel)};
+  ViterbiLexicon patched{delta.old_total()};
+  freeze(make_corpus(kOldModel), &patched);
+  ViterbiLexicon expected{delta.new_total()};
+  freeze(make_corpus(kNewModel), &expected);
+
+  ASSERT_TRUE(delta.Apply(&patched));
+  EXPECT_EQ(expected.size(), patched.size());
+  EXPECT_EQ(expected.total_morph_tokens(), patched.total_morph_tokens());
+  for (const std::string morph : {"re", "do", "er", "ing", "s", "x"}) {
+    EXPECT_EQ(expected.Find(morph), patched.Find(morph)) << morph;
+  }
+
+  // Applying it again finds the lexicon already changed, and leaves it.
+  EXPECT_FALSE(delta.Apply(&patched));
+  EXPECT_EQ(expected.Find("do"), patched.Find("do"));
+}
@@ -0,0 +1,97 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "model_server.h"
+
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "corpus_loader.h"
+#include "segmentation.h"
+
+using ModelServer = morfessor::ModelServer;
+using morfessor::tests::make_frozen;
+
+static const char kEnglish[] =
+    "Overall cost: 1.0\n50 walk\n80 ing\n90 s\n30 talk\n";
+static const char kFinnish[] =
+    "Overall cost: 1.0\n40 talo\n70 ssa\n60 i\n20 kissa\n";
+
+static std::string segment(const std::string& lexicon,
+    const std::string& word) {
+  std::vector<std::string> words{word};
+  make_frozen(lexicon, 2)->SegmentBatch(&words);
+  return words[0];
+}
+
+TEST(ModelServerTests, RoutesRequestsByNameInOrder)
+{
+  ModelServer server{3};
+  server.AddModel("en", make_frozen(kEnglish, 2), 1000);
+  server.AddModel("fi", make_frozen(kFinnish, 2), 2000);
+  EXPECT_EQ((std::vector<std::string>{"en", "fi"}), server.names());
+
+  // Enough requests for several batches, so that the workers finish them
+  // out of order.
+  std::vector<std::string> words{"walking", "taloissa", "talks", "kissassa",
+      "walks", "talossa"};
+  std::vector<std::string> models{"en", "fi", "en", "fi", "xx", ""};
+  std::vector<std::string> answer;
+  for (size_t j = 0; j < words.size(); ++j) {
+    answer.push_back(models[j] == "xx" ? ""
+        : segment(models[j] == "fi" ? kFinnish : kEnglish, words[j]));
+  }
+  std::stringstream requests;
+  std::vector<std::string> expected;
+  for (size_t i = 0; i < 20000; ++i) {
+    auto j = i % words.size();
+    if (models[j].empty()) {
+      requests << words[j] << "\n";
+    } else {
+      requests << models[j] << "\t" << words[j] << "\n";
+    }
+    expected.push_back(answer[j]);
+  }
+  std::stringstream answers;
+  server.Serve(requests, answers);
+
+  std::vector<std::string> lines;
+  std::string line;
+  while (getline(answers, line)) {
+    lines.push_back(line);
+  }
+  EXPECT_EQ(expected, lines);
+
+  auto english = server.stats("en");
+  auto finnish = server.stats("fi");
+  EXPECT_EQ(4u, english.morphs);
+  EXPECT_GT(english.lexicon_bytes, 0u);
+  EXPECT_EQ(1000u, english.resident_bytes);
+  EXPECT_EQ(2000u, finnish.resident_bytes);
+  EXPECT_EQ(10000u, english.words);
+  EXPECT_EQ(6667u, finnish.words);
+  EXPECT_EQ(3333u, server.unknown_requests());
+}
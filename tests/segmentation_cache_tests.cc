@@ -0,0 +1,114 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "segmentation_cache.h"
+
+#include <sstream>
+
+#include <gtest/gtest.h>
+
+#include "corpus.h"
+#include "corpus_loader.h"
+#include "lexicon_diff.h"
+
+using Corpus = morfessor::Corpus;
+using LexiconDiff = morfessor::LexiconDiff;
+using SegmentationCache = morfessor::SegmentationCache;
+using morfessor::tests::make_corpus;
+
+TEST(LexiconDiffTests, FindsChangedAddedAndRemovedMorphs)
+{
+  auto old_lexicon = make_corpus("Overall cost: 1.0\n3 re\n5 do\n4 ing\n");
+  auto new_lexicon = make_corpus("Overall cost: 2.0\n3 re\n6 do\n2 er\n");
+  LexiconDiff diff{old_lexicon, new_lexicon};
+
+  EXPECT_EQ(3, diff.changes().size());
+  EXPECT_FALSE(diff.changed("re"));
+  EXPECT_TRUE(diff.changed("do"));
+  EXPECT_TRUE(diff.changed("ing"));
+  EXPECT_TRUE(diff.changed("er"));
+  EXPECT_TRUE(diff.gained("do"));
+  EXPECT_TRUE(diff.gained("er"));
+  EXPECT_FALSE(diff.gained("ing"));
+  EXPECT_EQ(0, diff.changes().at("ing").second);
+  EXPECT_EQ(1, diff.unchanged().size());
+  EXPECT_EQ(3, diff.unchanged().at("re"));
+  EXPECT_EQ(2, diff.max_gained_length());
+  EXPECT_EQ(12, diff.old_total());
+  EXPECT_EQ(11, diff.new_total());
+}
+
+TEST(SegmentationCacheTests, ReadsWordsAndSegmentations)
+{
+  std::stringstream in{"re do ing \ntry ing \n"};
+  SegmentationCache cache{in};
+
+  EXPECT_EQ(2, cache.size());
+  ASSERT_NE(nullptr, cache.find("redoing"));
+  EXPECT_EQ("re do ing ", *cache.find("redoing"));
+  EXPECT_EQ(nullptr, cache.find("doing"));
+}
+
+TEST(SegmentationCacheTests, InvalidatesWordsUsingChangedMorphs)
+{
+  std::stringstream in{"re do ing \ntry ing \nwalk \n"};
+  SegmentationCache cache{in};
+  LexiconDiff diff{make_corpus("3 re\n5 do\n4 ing\n2 try\n1 walk\n"),
+      make_corpus("3 re\n4 do\n4 ing\n2 try\n1 walk\n1 x\n")};
+
+  EXPECT_EQ(1, cache.Invalidate(diff));
+  EXPECT_EQ(nullptr, cache.find("redoing"));
+  EXPECT_NE(nullptr, cache.previous("redoing"));
+  EXPECT_NE(nullptr, cache.find("trying"));
+  EXPECT_NE(nullptr, cache.find("walk"));
+}
+
+TEST(SegmentationCacheTests, InvalidatesWordsContainingGainedMorphs)
+{
+  std::stringstream in{"re do ing \ntry ing \nwalk \n"};
+  SegmentationCache cache{in};
+  LexiconDiff diff{
+      make_corpus("3 re\n5 do\n4 ing\n2 try\n1 walk\n2 zz\n"),
+      make_corpus("3 re\n5 do\n4 ing\n2 try\n1 walk\n1 zz\n1 al\n")};
+
+  EXPECT_EQ(1, cache.Invalidate(diff));
+  EXPECT_EQ(nullptr, cache.find("walk"));
+  EXPECT_NE(nullptr, cache.find("redoing"));
+  EXPECT_NE(nullptr, cache.find("trying"));
+}
+
+TEST(SegmentationCacheTests, InvalidatesWordsWhoseCostsMoveWithTheTotal)
+{
+  std::stringstream in{"walk \nwalk er \nzz er \nzz y \n"};
+  SegmentationCache cache{in};
+  // The new morph raises the total from 16 to 21, which moves the cost of
+  // walk from 2 to 3 nats and that of an unknown letter in a word of three
+  // letters from 11 to 12, but leaves the other morphs at 1.
+  LexiconDiff diff{make_corpus("1 walk\n3 er\n3 zz\n3 z\n3 e\n3 r\n"),
+      make_corpus("1 walk\n3 er\n3 zz\n3 z\n3 e\n3 r\n5 q\n")};
+
+  EXPECT_EQ(3, cache.Invalidate(diff));
+  EXPECT_EQ(nullptr, cache.find("walk"));
+  EXPECT_EQ(nullptr, cache.find("walker"));
+  EXPECT_EQ(nullptr, cache.find("zzy"));
+  EXPECT_NE(nullptr, cache.find("zzer"));
+}
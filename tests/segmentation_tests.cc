@@ -22,14 +22,24 @@
 
 #include "segmentation.h"
 
+#include <algorithm>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <fstream>
+#include <map>
 #include <memory>
 #include <sstream>
 #include <iostream>
+#include <vector>
 
 #include <gtest/gtest.h>
 
+#include "boundary_statistics.h"
 #include "corpus.h"
 #include "model.h"
+#include "model_delta.h"
+#include "morph.h"
 #include "corpus_loader.h"
 
 using Model = morfessor::Model;
@@ -153,3 +163,391 @@ TEST(SegmentationTests, BaselineFreqLengthSaneAfterSplitting) {
 
   test_against_reference(model1, s1);
 }
+
+TEST(SegmentationTests, SegmentTextKeepsPunctuationAndCase) {
+  std::stringstream model_file;
+  model_file << "3 re" << std::endl << "5 do" << std::endl
+      << "4 ing" << std::endl << "2 try" << std::endl;
+  Corpus model_corpus{model_file};
+  auto model = std::make_shared<BaselineModel>(model_corpus);
+  Segmentation s1(model_corpus, model);
+
+  std::stringstream text{"Redoing, (trying) re-do!\n"};
+  std::stringstream results;
+  s1.SegmentText(text, results, "+");
+  EXPECT_EQ("Re+do+ing, (try+ing) re-do!\n", results.str());
+}
+
+TEST(SegmentationTests, SegmentTextIsTheSameAcrossBatchesAndFrozen) {
+  std::stringstream model_file;
+  model_file << "3 re" << std::endl << "5 do" << std::endl
+      << "4 ing" << std::endl << "2 try" << std::endl;
+  Corpus model_corpus{model_file};
+  auto model = std::make_shared<BaselineModel>(model_corpus);
+  Segmentation s1(model_corpus, model);
+
+  // More words than one batch, so that a gap is carried over between them.
+  std::string text;
+  std::string expected;
+  for (size_t i = 0; i < Segmentation::kTextBatchWords + 10; ++i) {
+    text += i % 3 == 0 ? "Redoing, " : (i % 3 == 1 ? "trying\n" : "x-re ");
+    expected += i % 3 == 0 ? "Re+do+ing, "
+        : (i % 3 == 1 ? "try+ing\n" : "x-re ");
+  }
+  text += "...";
+  expected += "...";
+
+  std::stringstream in{text};
+  std::stringstream results;
+  s1.SegmentText(in, results, "+");
+  EXPECT_EQ(expected, results.str());
+
+  s1.Freeze();
+  std::stringstream frozen_in{text};
+  std::stringstream frozen_results;
+  s1.SegmentText(frozen_in, frozen_results, "+");
+  EXPECT_EQ(expected, frozen_results.str());
+}
+
+TEST(SegmentationTests, OptimizeWithSpillingMatchesModel) {
+  const Corpus& corpus = corpus_loader().corpus3;
+  auto model = std::make_shared<BaselineFrequencyLengthModel>(corpus);
+  Segmentation s1(corpus, model, "segmentation_tests.spill", 4);
+  s1.Optimize();
+  test_against_reference(model, s1);
+  EXPECT_GT(s1.spill_stats()->evictions, 0u);
+  EXPECT_GT(s1.spill_stats()->page_ins, 0u);
+}
+
+TEST(SegmentationTests, FrontCodedModelLoadsLikeTextModel) {
+  const Corpus& corpus = corpus_loader().corpus3;
+  auto model = std::make_shared<BaselineModel>(corpus);
+  Segmentation s1(corpus, model);
+  s1.Optimize();
+
+  const std::string text_path = "segmentation_tests.model.txt";
+  const std::string front_coded_path = "segmentation_tests.model.fc";
+  {
+    std::ofstream text{text_path};
+    s1.print(text);
+    std::ofstream front_coded{front_coded_path, std::ios::binary};
+    s1.print_front_coded(front_coded);
+  }
+  Corpus text_corpus{text_path};
+  Corpus front_coded_corpus{front_coded_path};
+  std::remove(text_path.c_str());
+  std::remove(front_coded_path.c_str());
+
+  // The text model starts with its cost line, which reads as an empty morph.
+  std::map<std::string, size_t> expected;
+  for (auto iter = text_corpus.cbegin(); iter != text_corpus.cend(); ++iter) {
+    if (!iter->letters().empty()) {
+      expected[iter->letters()] = iter->frequency();
+    }
+  }
+  std::map<std::string, size_t> actual;
+  for (auto iter = front_coded_corpus.cbegin();
+      iter != front_coded_corpus.cend(); ++iter) {
+    actual[iter->letters()] = iter->frequency();
+  }
+  EXPECT_EQ(expected, actual);
+  EXPECT_FALSE(actual.empty());
+
+  // The model segments the same way in either format.
+  auto text_model = std::make_shared<BaselineModel>(text_corpus);
+  auto front_coded_model = std::make_shared<BaselineModel>(front_coded_corpus);
+  Segmentation text_st(text_corpus, text_model);
+  Segmentation front_coded_st(front_coded_corpus, front_coded_model);
+  for (const auto& word : {"abandonment", "abacus", "zzq"}) {
+    EXPECT_EQ(text_st.SegmentWord(word), front_coded_st.SegmentWord(word));
+  }
+}
+
+TEST(SegmentationTests, SeedSplitsLowersCostAndKeepsModelConsistent) {
+  const Corpus& corpus = corpus_loader().corpus3;
+  auto model = std::make_shared<BaselineLengthModel>(corpus);
+  Segmentation s1(corpus, model);
+  auto unsplit_cost = model->overall_cost();
+
+  morfessor::BoundaryStatistics statistics{corpus, 2};
+  EXPECT_GT(s1.SeedSplits(corpus, statistics, 0.5), 0u);
+  EXPECT_LT(model->overall_cost(), unsplit_cost);
+  test_against_reference(model, s1);
+
+  s1.Optimize(corpus);
+  test_against_reference(model, s1);
+}
+
+TEST(SegmentationTests, RareWordsAddedAfterTrainingKeepModelConsistent) {
+  const Corpus& corpus = corpus_loader().corpus3;
+  std::vector<morfessor::Morph> rare_words;
+  for (auto iter = corpus.cbegin(); iter != corpus.cend(); ++iter) {
+    if (iter->frequency() < 3) {
+      rare_words.push_back(*iter);
+    }
+  }
+  Corpus rare{rare_words};
+  auto model = std::make_shared<BaselineLengthModel>(corpus);
+  Segmentation s1(corpus, model);
+
+  s1.RemoveWords(rare);
+  for (auto iter = rare.cbegin(); iter != rare.cend(); ++iter) {
+    EXPECT_FALSE(s1.contains(iter->letters()));
+  }
+  s1.Optimize();
+
+  EXPECT_EQ(rare.size(), s1.AddViterbiSplits(rare));
+  for (auto iter = rare.cbegin(); iter != rare.cend(); ++iter) {
+    EXPECT_LE(iter->frequency(), s1.at(iter->letters()).count);
+  }
+  test_against_reference(model, s1);
+}
+
+TEST(SegmentationTests, SegmentBatchMatchesSegmentWord) {
+  const Corpus& corpus = corpus_loader().corpus3;
+  auto model = std::make_shared<BaselineLengthModel>(corpus);
+  Segmentation s1(corpus, model);
+  s1.Optimize();
+
+  // Neighbours that share prefixes, repeated words, letters that are not
+  // in the lexicon, and more words of one length than there are lanes.
+  std::vector<std::string> words{"abacus", "abaci", "abacus", "", "zzq",
+      "abandon", "abandons", "abandoned", "abandoning", "abandonment",
+      "aback", "abacx", "abacy", "abacz", "abadx", "abady", "abadz", "qqqqq",
+      "xabcd", "aback"};
+  std::vector<std::string> expected;
+  for (const auto& word : words) {
+    expected.push_back(s1.SegmentWord(word));
+  }
+
+  auto batch = words;
+  s1.SegmentBatch(&batch);
+  EXPECT_EQ(expected, batch);
+
+  s1.Freeze();
+  batch = words;
+  s1.SegmentBatch(&batch);
+  EXPECT_EQ(expected, batch);
+  EXPECT_EQ(0u, s1.lexicon_stats().hot_hits);
+  EXPECT_GT(s1.lexicon_stats().cold_hits, 0u);
+
+  s1.Freeze(16);
+  auto before = s1.lexicon_stats();
+  batch = words;
+  s1.SegmentBatch(&batch);
+  EXPECT_EQ(expected, batch);
+  auto batched = s1.lexicon_stats();
+  EXPECT_GT(batched.hot_hits, before.hot_hits);
+
+  // Looking the substrings up one at a time finds the same morphs.
+  s1.set_batch_probes(false);
+  batch = words;
+  s1.SegmentBatch(&batch);
+  EXPECT_EQ(expected, batch);
+  auto single = s1.lexicon_stats();
+  EXPECT_EQ(batched.hot_hits - before.hot_hits,
+      single.hot_hits - batched.hot_hits);
+  EXPECT_EQ(batched.cold_hits - before.cold_hits,
+      single.cold_hits - batched.cold_hits);
+  EXPECT_EQ(batched.misses - before.misses, single.misses - batched.misses);
+
+  // The frozen lexicon is all that segmenting a batch needs.
+  s1.set_batch_probes(true);
+  s1.ReleaseNodes();
+  batch = words;
+  s1.SegmentBatch(&batch);
+  EXPECT_EQ(expected, batch);
+}
+
+TEST(SegmentationTests, SegmentBatchSplitsVeryLongWords) {
+  const Corpus& corpus = corpus_loader().corpus3;
+  auto model = std::make_shared<BaselineLengthModel>(corpus);
+  Segmentation s1(corpus, model);
+  s1.Optimize();
+
+  // Words made of known morphs and stray letters, longer than any morph
+  // and than the longest word split in lockstep without a frozen lexicon.
+  std::string long_word;
+  while (long_word.size() < 1500) {
+    long_word += "abandonmentzabacus";
+  }
+  std::vector<std::string> words{long_word, long_word + "q",
+      long_word.substr(1), "abacus"};
+  std::vector<std::string> expected;
+  for (const auto& word : words) {
+    expected.push_back(s1.SegmentWord(word));
+  }
+
+  auto batch = words;
+  s1.SegmentBatch(&batch);
+  EXPECT_EQ(expected, batch);
+
+  s1.Freeze(16);
+  batch = words;
+  s1.SegmentBatch(&batch);
+  EXPECT_EQ(expected, batch);
+
+  // The table of a frozen lexicon only spans its longest morph, so a word
+  // of 100k letters takes a few tens of megabytes, not hundreds of
+  // gigabytes.
+  std::string huge_word;
+  while (huge_word.size() < 100000) {
+    huge_word += long_word;
+  }
+  batch = {huge_word};
+  s1.SegmentBatch(&batch);
+  EXPECT_EQ(huge_word.size(), batch[0].size() - std::count(batch[0].begin(),
+      batch[0].end(), ' '));
+  EXPECT_EQ(0, batch[0].compare(0, expected[0].size() / 2,
+      expected[0], 0, expected[0].size() / 2));
+}
+
+TEST(SegmentationTests, FinerFrozenCostsStillSplitEveryWord) {
+  const Corpus& corpus = corpus_loader().corpus3;
+  auto model = std::make_shared<BaselineLengthModel>(corpus);
+  Segmentation s1(corpus, model);
+  s1.Optimize();
+
+  std::vector<std::string> words{"abacus", "abandonment", "zzq", "abadz"};
+  s1.Freeze(0, 1024);
+  auto batch = words;
+  s1.SegmentBatch(&batch);
+  for (size_t i = 0; i < words.size(); ++i) {
+    auto letters = batch[i];
+    letters.erase(std::remove(letters.begin(), letters.end(), ' '),
+        letters.end());
+    EXPECT_EQ(words[i], letters);
+    EXPECT_EQ(' ', batch[i].back());
+  }
+}
+
+TEST(SegmentationTests, OptimizeReportsProgressWhenRequested) {
+  const Corpus& corpus = corpus_loader().corpus3;
+  auto model = std::make_shared<BaselineModel>(corpus);
+  Segmentation s1(corpus, model);
+
+  volatile std::sig_atomic_t request = 1;
+  std::vector<morfessor::OptimizeProgress> reports;
+  s1.set_progress_request(&request,
+      [&reports](const morfessor::OptimizeProgress& progress) {
+        reports.push_back(progress);
+      });
+  s1.Optimize(corpus);
+
+  ASSERT_EQ(1, reports.size());
+  EXPECT_EQ(0, request);
+  EXPECT_EQ(1, reports[0].epoch);
+  EXPECT_EQ(0, reports[0].position);
+  EXPECT_EQ(corpus.size(), reports[0].words);
+}
+
+TEST(SegmentationTests, ApplyDeltaMatchesLoadingTheNewModel) {
+  const Corpus& corpus = corpus_loader().corpus3;
+  auto model = std::make_shared<BaselineModel>(corpus);
+  Segmentation trained(corpus, model);
+  trained.Optimize();
+  std::stringstream old_file;
+  trained.print(old_file);
+  Corpus old_model{old_file};
+
+  // A later run that saw more of some morphs, lost one and found another.
+  std::vector<morfessor::Morph> morphs;
+  for (auto iter = old_model.cbegin(); iter != old_model.cend(); ++iter) {
+    morphs.push_back(*iter);
+  }
+  morphs[1] = morfessor::Morph{morphs[1].letters(), morphs[1].frequency() + 7};
+  morphs.erase(morphs.begin() + 2);
+  morphs.emplace_back("zzq", 3);
+  Corpus new_model{morphs};
+  morfessor::ModelDelta delta{old_model, new_model};
+
+  std::vector<std::string> words{"abacus", "abandonment", "zzq", "abadz",
+      "aback"};
+  Segmentation loaded(new_model, std::make_shared<BaselineModel>(new_model));
+  loaded.Freeze(8);
+  auto expected = words;
+  loaded.SegmentBatch(&expected);
+
+  Segmentation patched(old_model, std::make_shared<BaselineModel>(old_model));
+  patched.Freeze(8);
+  ASSERT_TRUE(patched.ApplyDelta(delta));
+  auto batch = words;
+  patched.SegmentBatch(&batch);
+  EXPECT_EQ(expected, batch);
+  EXPECT_FALSE(patched.ApplyDelta(delta));
+
+  // Without the frozen copy the nodes are changed the same way.
+  Segmentation unfrozen(old_model,
+      std::make_shared<BaselineModel>(old_model));
+  ASSERT_TRUE(unfrozen.ApplyDelta(delta));
+  for (const auto& word : words) {
+    EXPECT_EQ(loaded.SegmentWord(word), unfrozen.SegmentWord(word));
+  }
+}
+
+TEST(SegmentationTests, ScoreAddsUpTheCheapestSplits) {
+  Corpus model_corpus{std::vector<morfessor::Morph>{{"ab", 3}, {"c", 1}}};
+  Segmentation st(model_corpus,
+      std::make_shared<BaselineModel>(model_corpus));
+  Corpus heldout{std::vector<morfessor::Morph>{{"abc", 2}, {"x", 1},
+      {"", 0}}};
+
+  // abc is ab + c; x is an unknown letter, which costs as much as two
+  // morphs that are each every token.
+  auto expected = 2 * ((std::log(4) - std::log(3)) + std::log(4))
+      + 2 * std::log(4);
+  EXPECT_DOUBLE_EQ(expected, st.Score(heldout));
+}
+
+TEST(SegmentationTests, ScoreIsTheSameAfterLoadingAndOnAnyThreads) {
+  const Corpus& corpus = corpus_loader().corpus3;
+  auto model = std::make_shared<BaselineModel>(corpus);
+  Segmentation trained(corpus, model);
+  trained.set_seed(1);
+  trained.Optimize();
+  std::stringstream model_file;
+  trained.print(model_file);
+  Corpus lexicon{model_file};
+  Segmentation loaded(lexicon, std::make_shared<BaselineModel>(lexicon));
+
+  // The held-out list spans many blocks of words.
+  const Corpus& heldout = corpus_loader().corpus4;
+  auto cost = trained.Score(heldout);
+  EXPECT_GT(cost, 0);
+  EXPECT_EQ(cost, trained.Score(heldout, 3));
+  EXPECT_DOUBLE_EQ(cost, loaded.Score(heldout));
+}
+
+TEST(SegmentationTests, OptimizeScoresHeldoutAfterEveryEpoch) {
+  const Corpus& corpus = corpus_loader().corpus3;
+  const Corpus& heldout = corpus_loader().corpus2;
+  Segmentation unscored(corpus, std::make_shared<BaselineModel>(corpus));
+  unscored.set_seed(5);
+  unscored.Optimize();
+  EXPECT_TRUE(unscored.heldout_costs().empty());
+
+  Segmentation scored(corpus, std::make_shared<BaselineModel>(corpus));
+  scored.set_seed(5);
+  scored.set_heldout(&heldout, 0, 2);
+  scored.Optimize();
+  ASSERT_EQ(unscored.epoch_seconds().size(),
+      scored.heldout_costs().size());
+  EXPECT_EQ(scored.Score(heldout), scored.heldout_costs().back());
+
+  // Patience of one epoch stops at the first epoch that is no better.
+  Segmentation stopped(corpus, std::make_shared<BaselineModel>(corpus));
+  stopped.set_seed(5);
+  stopped.set_heldout(&heldout, 1, 1);
+  stopped.Optimize();
+  const auto& costs = scored.heldout_costs();
+  size_t expected_epochs = 1;
+  while (expected_epochs < costs.size()
+      && costs[expected_epochs] < *std::min_element(costs.begin(),
+          costs.begin() + expected_epochs)) {
+    ++expected_epochs;
+  }
+  expected_epochs = std::min(costs.size(), expected_epochs + 1);
+  EXPECT_EQ(expected_epochs, stopped.heldout_costs().size());
+  EXPECT_TRUE(std::equal(stopped.heldout_costs().begin(),
+      stopped.heldout_costs().end(), costs.begin()));
+}
@@ -0,0 +1,170 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "shared_ring.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "corpus_loader.h"
+#include "model_server.h"
+#include "segmentation.h"
+
+using ModelServer = morfessor::ModelServer;
+using RingClient = morfessor::RingClient;
+using SharedRing = morfessor::SharedRing;
+using morfessor::tests::make_frozen;
+
+static const char kRingPath[] = "shared_ring_tests.ring";
+
+/// Turns the offsets a client reads back into the line --load writes.
+static std::string join(const std::string& word, const uint8_t* ends,
+    size_t morphs) {
+  std::string line;
+  size_t begin = 0;
+  for (size_t i = 0; i < morphs; ++i) {
+    line += word.substr(begin, ends[i] - begin) + " ";
+    begin = ends[i];
+  }
+  return line;
+}
+
+TEST(SharedRingTests, FindsModelsByName)
+{
+  SharedRing ring{kRingPath, true, {"en", "fi"}};
+  SharedRing opened{kRingPath, false};
+  EXPECT_EQ(0, opened.model("en"));
+  EXPECT_EQ(1, opened.model("fi"));
+  EXPECT_EQ(-1, opened.model("tr"));
+}
+
+TEST(SharedRingTests, ClientGetsTheSplitsOfTheServer)
+{
+  const char english[] = "Overall cost: 1.0\n50 walk\n80 ing\n90 s\n30 talk\n";
+  const char finnish[] = "Overall cost: 1.0\n40 talo\n70 ssa\n60 i\n";
+  ModelServer server{1};
+  server.AddModel("en", make_frozen(english), 0);
+  server.AddModel("fi", make_frozen(finnish), 0);
+  SharedRing ring{kRingPath, true, server.names()};
+  std::thread serving{[&server, &ring] { server.ServeRing(&ring); }};
+
+  std::vector<std::string> words{"walking", "taloissa", "talks", "", "s"};
+  std::vector<int> models{0, 1, 0, 0, 7};
+  std::vector<std::string> expected;
+  for (size_t i = 0; i < words.size(); ++i) {
+    std::vector<std::string> batch{words[i]};
+    if (models[i] < 2) {
+      make_frozen(models[i] == 0 ? english : finnish)->SegmentBatch(&batch);
+      expected.push_back(batch[0]);
+    } else {
+      expected.push_back("");
+    }
+  }
+
+  {
+    RingClient client{kRingPath};
+    // More words than slots, in round trips of different sizes, and one
+    // after the server has gone to sleep.
+    size_t next = 0;
+    for (size_t round = 0; round < 40; ++round) {
+      if (round == 20) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      }
+      auto count = std::min<size_t>(client.room(), round * 13 + 1);
+      for (size_t i = 0; i < count; ++i) {
+        auto j = (next + i) % words.size();
+        client.Push(models[j], words[j].data(), words[j].size());
+      }
+      client.Flush();
+      for (size_t i = 0; i < count; ++i, ++next) {
+        auto j = next % words.size();
+        size_t morphs;
+        auto ends = client.Pop(&morphs);
+        ASSERT_EQ(expected[j], join(words[j], ends, morphs)) << words[j];
+      }
+    }
+  }
+  serving.join();
+  EXPECT_GT(server.stats("en").words, 0u);
+  EXPECT_GT(server.stats("fi").words, 0u);
+  EXPECT_GT(server.unknown_requests(), 0u);
+}
+
+TEST(SharedRingTests, ServerRejectsWordsLongerThanASlot)
+{
+  ModelServer server{1};
+  server.AddModel("en", make_frozen("50 walk\n80 ing\n"), 0);
+  SharedRing ring{kRingPath, true, server.names()};
+  std::thread serving{[&server, &ring] { server.ServeRing(&ring); }};
+
+  {
+    RingClient client{kRingPath};
+    client.Push(0, "walking", 7);
+    client.Push(0, "walking", 7);
+    // A client that writes past the word, through its own mapping.
+    SharedRing tampered{kRingPath, false};
+    tampered.slot(0).length = 255;
+    client.Flush();
+    size_t morphs;
+    client.Pop(&morphs);
+    EXPECT_EQ(0u, morphs);
+    client.Pop(&morphs);
+    EXPECT_EQ(2u, morphs);
+  }
+  serving.join();
+  EXPECT_EQ(1u, server.malformed_requests());
+  EXPECT_EQ(0u, server.unknown_requests());
+}
+
+TEST(SharedRingTests, WordOfSpacesGetsOneEndPerMorph)
+{
+  ModelServer server{1};
+  server.AddModel("en", make_frozen("50 walk\n80 ing\n"), 0);
+  SharedRing ring{kRingPath, true, server.names()};
+  std::thread serving{[&server, &ring] { server.ServeRing(&ring); }};
+
+  // Spaces are unknown letters, so each is a morph of its own; the ends
+  // must not spill into the next slot, which holds a word of its own.
+  std::string spaces(SharedRing::kMaxWordBytes, ' ');
+  {
+    RingClient client{kRingPath};
+    client.Push(0, spaces.data(), spaces.size());
+    client.Push(0, "walking", 7);
+    client.Flush();
+    size_t morphs;
+    auto ends = client.Pop(&morphs);
+    ASSERT_EQ(spaces.size(), morphs);
+    for (size_t i = 0; i < morphs; ++i) {
+      EXPECT_EQ(i + 1, ends[i]);
+    }
+    ends = client.Pop(&morphs);
+    EXPECT_EQ("walk ing ", join("walking", ends, morphs));
+  }
+  serving.join();
+  EXPECT_EQ(0u, server.malformed_requests());
+}
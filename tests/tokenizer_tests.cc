@@ -0,0 +1,81 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "tokenizer.h"
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+using morfessor::FindWordStart;
+using morfessor::FindWordEnd;
+using morfessor::is_word_byte;
+
+TEST(TokenizerTests, FindsWordsInShortText)
+{
+  std::string text = "  hello, world";
+  EXPECT_EQ(2, FindWordStart(text.data(), 0, text.size()));
+  EXPECT_EQ(7, FindWordEnd(text.data(), 2, text.size()));
+  EXPECT_EQ(9, FindWordStart(text.data(), 7, text.size()));
+  EXPECT_EQ(text.size(), FindWordEnd(text.data(), 9, text.size()));
+}
+
+TEST(TokenizerTests, FindsWordsPastSixteenBytes)
+{
+  std::string text = std::string(37, ' ') + "Abandon" + std::string(20, '.');
+  EXPECT_EQ(37, FindWordStart(text.data(), 0, text.size()));
+  EXPECT_EQ(44, FindWordEnd(text.data(), 37, text.size()));
+  EXPECT_EQ(text.size(), FindWordStart(text.data(), 44, text.size()));
+}
+
+TEST(TokenizerTests, DigitsAndPunctuationEndWords)
+{
+  std::string text = "abc1def-ghi@jkl[mno`pqr{stu";
+  EXPECT_EQ(3, FindWordEnd(text.data(), 0, text.size()));
+  EXPECT_EQ(7, FindWordEnd(text.data(), 4, text.size()));
+  EXPECT_EQ(11, FindWordEnd(text.data(), 8, text.size()));
+  EXPECT_EQ(15, FindWordEnd(text.data(), 12, text.size()));
+  EXPECT_EQ(19, FindWordEnd(text.data(), 16, text.size()));
+  EXPECT_EQ(23, FindWordEnd(text.data(), 20, text.size()));
+}
+
+TEST(TokenizerTests, KeepsAccentedLettersAndInnerApostrophes)
+{
+  std::string text = "\xc3\xa4rger action's 'quoted'";
+  EXPECT_EQ(6, FindWordEnd(text.data(), 0, text.size()));
+  EXPECT_EQ(15, FindWordEnd(text.data(), 7, text.size()));
+  EXPECT_EQ(17, FindWordStart(text.data(), 15, text.size()));
+  EXPECT_EQ(23, FindWordEnd(text.data(), 17, text.size()));
+}
+
+TEST(TokenizerTests, SixteenByteScanAgreesWithIsWordByte)
+{
+  for (int c = 1; c < 256; ++c) {
+    std::string block(16, static_cast<char>(c));
+    size_t word_bytes = is_word_byte(c) ? 16 : 0;
+    std::string text = block + "a";
+    EXPECT_EQ(16 - word_bytes, FindWordStart(text.data(), 0, text.size()))
+        << c;
+    text = block + "-";
+    EXPECT_EQ(word_bytes, FindWordEnd(text.data(), 0, text.size())) << c;
+  }
+}
@@ -0,0 +1,202 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "viterbi_lexicon.h"
+
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using ViterbiLexicon = morfessor::ViterbiLexicon;
+
+TEST(ViterbiLexiconTests, FindsCostsOfAddedMorphs)
+{
+  ViterbiLexicon lexicon{1000};
+  lexicon.Add("walk", 10);
+  lexicon.Add("ing", 100);
+  lexicon.Add("s", 1000);
+
+  EXPECT_EQ(static_cast<int>(std::log(1000) - std::log(10)),
+      lexicon.Find("walk"));
+  EXPECT_EQ(static_cast<int>(std::log(1000) - std::log(100)),
+      lexicon.Find("ing"));
+  EXPECT_EQ(0, lexicon.Find("s"));
+  EXPECT_EQ(ViterbiLexicon::kMissing, lexicon.Find("wal"));
+  EXPECT_EQ(ViterbiLexicon::kMissing, lexicon.Find("walks"));
+  EXPECT_EQ(4u, lexicon.max_length());
+  EXPECT_EQ(3u, lexicon.size());
+}
+
+TEST(ViterbiLexiconTests, KeepsFractionsOfANatWithMoreSteps)
+{
+  ViterbiLexicon lexicon{1000, 256};
+  lexicon.Add("walk", 10);
+  lexicon.Add("s", 1000);
+  EXPECT_EQ(256u, lexicon.steps_per_nat());
+  EXPECT_EQ(static_cast<int>(256 * (std::log(1000) - std::log(10))),
+      lexicon.Find("walk"));
+  EXPECT_EQ(0, lexicon.Find("s"));
+
+  lexicon.Reorder(1);
+  EXPECT_EQ(static_cast<int>(256 * (std::log(1000) - std::log(10))),
+      lexicon.Find("walk"));
+}
+
+TEST(ViterbiLexiconTests, HashCanBeBuiltOneLetterAtATime)
+{
+  const std::string word = "walking";
+  auto hash = ViterbiLexicon::HashStart();
+  for (size_t length = 1; length <= word.size(); ++length) {
+    hash = ViterbiLexicon::HashStep(hash, word[length - 1]);
+    EXPECT_EQ(ViterbiLexicon::Hash(word.data(), length), hash);
+  }
+}
+
+TEST(ViterbiLexiconTests, KeepsEveryMorphWhenGrowing)
+{
+  ViterbiLexicon lexicon{1 << 20};
+  for (size_t i = 1; i <= 5000; ++i) {
+    lexicon.Add("m" + std::to_string(i), i);
+  }
+  for (size_t i = 1; i <= 5000; ++i) {
+    EXPECT_EQ(static_cast<int>(std::log(1 << 20) - std::log(i)),
+        lexicon.Find("m" + std::to_string(i)));
+  }
+  EXPECT_EQ(ViterbiLexicon::kMissing, lexicon.Find("m0"));
+}
+
+TEST(ViterbiLexiconTests, ReorderKeepsCostsAndCountsTiers)
+{
+  ViterbiLexicon lexicon{1 << 20};
+  const std::string long_morph(ViterbiLexicon::kHotKeyBytes + 1, 'x');
+  lexicon.Add(long_morph, 1 << 19);
+  for (size_t i = 1; i <= 100; ++i) {
+    lexicon.Add("m" + std::to_string(i), i);
+  }
+  lexicon.Reorder(10);
+  EXPECT_EQ(10u, lexicon.hot_size());
+  EXPECT_EQ(101u, lexicon.size());
+
+  morfessor::LexiconTierStats stats;
+  auto find = [&lexicon, &stats](const std::string& morph) {
+    return lexicon.Find(morph.data(), morph.size(),
+        ViterbiLexicon::Hash(morph.data(), morph.size()), &stats);
+  };
+  // The most frequent morph is too long for the hot array.
+  EXPECT_EQ(static_cast<int>(std::log(1 << 20) - std::log(1 << 19)),
+      find(long_morph));
+  EXPECT_EQ(static_cast<int>(std::log(1 << 20) - std::log(100)),
+      find("m100"));
+  EXPECT_EQ(static_cast<int>(std::log(1 << 20) - std::log(1)), find("m1"));
+  EXPECT_EQ(ViterbiLexicon::kMissing, find("m101"));
+  EXPECT_EQ(1u, stats.hot_hits);
+  EXPECT_EQ(2u, stats.cold_hits);
+  EXPECT_EQ(1u, stats.misses);
+
+  // Morphs added afterwards are cold.
+  lexicon.Add("late", 1000);
+  EXPECT_EQ(static_cast<int>(std::log(1 << 20) - std::log(1000)),
+      find("late"));
+  EXPECT_EQ(3u, stats.cold_hits);
+}
+
+TEST(ViterbiLexiconTests, FindBatchMatchesFind)
+{
+  ViterbiLexicon lexicon{1 << 20};
+  for (size_t i = 1; i <= 1000; ++i) {
+    lexicon.Add("m" + std::to_string(i), i);
+  }
+  lexicon.Reorder(100);
+
+  // More probes than are prefetched ahead, half of them misses.
+  std::vector<std::string> morphs;
+  for (size_t i = 0; i < 4 * ViterbiLexicon::kPrefetchDistance + 3; ++i) {
+    morphs.push_back("m" + std::to_string(i * 37));
+  }
+  std::vector<ViterbiLexicon::Probe> probes;
+  for (const auto& morph : morphs) {
+    probes.push_back(ViterbiLexicon::Probe{morph.data(), morph.size(),
+        ViterbiLexicon::Hash(morph.data(), morph.size())});
+  }
+  std::vector<int> costs(probes.size());
+  morfessor::LexiconTierStats stats;
+  lexicon.FindBatch(probes.data(), probes.size(), costs.data(), &stats);
+
+  morfessor::LexiconTierStats expected_stats;
+  for (size_t i = 0; i < morphs.size(); ++i) {
+    EXPECT_EQ(lexicon.Find(probes[i].morph, probes[i].length,
+        probes[i].hash, &expected_stats), costs[i]) << morphs[i];
+  }
+  EXPECT_EQ(expected_stats.hot_hits, stats.hot_hits);
+  EXPECT_EQ(expected_stats.cold_hits, stats.cold_hits);
+  EXPECT_EQ(expected_stats.misses, stats.misses);
+  EXPECT_GT(stats.misses, 0u);
+
+  lexicon.FindBatch(probes.data(), 0, costs.data());
+}
+
+TEST(ViterbiLexiconTests, SetCountChangesAddsAndRemovesMorphs)
+{
+  ViterbiLexicon lexicon{1000};
+  lexicon.Add("walk", 10);
+  lexicon.Add("ing", 100);
+  lexicon.Add("s", 500);
+  lexicon.Add("ed", 390);
+  lexicon.Reorder(2);
+
+  // A hot and a cold morph change, one of each goes and one is new.
+  lexicon.SetCount("s", 400);
+  lexicon.SetCount("walk", 20);
+  lexicon.SetCount("ing", 0);
+  lexicon.SetCount("ed", 0);
+  lexicon.SetCount("er", 580);
+  lexicon.SetTotal(1000);
+  EXPECT_EQ(3u, lexicon.size());
+  EXPECT_EQ(1000u, lexicon.total_morph_tokens());
+  EXPECT_EQ(static_cast<int>(std::log(1000) - std::log(400)),
+      lexicon.Find("s"));
+  EXPECT_EQ(static_cast<int>(std::log(1000) - std::log(20)),
+      lexicon.Find("walk"));
+  EXPECT_EQ(static_cast<int>(std::log(1000) - std::log(580)),
+      lexicon.Find("er"));
+  EXPECT_EQ(ViterbiLexicon::kMissing, lexicon.Find("ing"));
+  EXPECT_EQ(ViterbiLexicon::kMissing, lexicon.Find("ed"));
+
+  std::map<std::string, size_t> counts;
+  lexicon.ForEach([&counts](const std::string& morph, size_t count) {
+    counts[morph] = count;
+  });
+  EXPECT_EQ((std::map<std::string, size_t>{{"er", 580}, {"s", 400},
+      {"walk", 20}}), counts);
+
+  // A removed morph can come back.
+  lexicon.SetCount("ing", 100);
+  lexicon.SetTotal(1100);
+  EXPECT_EQ(4u, lexicon.size());
+  EXPECT_EQ(static_cast<int>(std::log(1100) - std::log(100)),
+      lexicon.Find("ing"));
+  EXPECT_EQ(static_cast<int>(std::log(1100) - std::log(20)),
+      lexicon.Find("walk"));
+}
@@ -0,0 +1,139 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2016 Derek Felson
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "word_counter.h"
+
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "corpus.h"
+
+using Corpus = morfessor::Corpus;
+using CountMinSketch = morfessor::CountMinSketch;
+using WordCountOptions = morfessor::WordCountOptions;
+using WordCountStats = morfessor::WordCountStats;
+
+static std::map<std::string, size_t> count_file(const std::string& text,
+    const WordCountOptions& options, WordCountStats* stats) {
+  const char* path = "word_counter_tests.txt";
+  {
+    std::ofstream out{path};
+    out << text;
+  }
+  auto corpus = morfessor::CountWords(path, options, stats);
+  std::remove(path);
+
+  std::map<std::string, size_t> counts;
+  for (auto iter = corpus.cbegin(); iter != corpus.cend(); ++iter) {
+    counts[iter->letters()] += iter->frequency();
+  }
+  return counts;
+}
+
+TEST(WordCounterTests, SketchNeverUnderestimates)
+{
+  CountMinSketch sketch{64, 4};
+  std::hash<std::string> hasher;
+  for (size_t i = 0; i < 1000; ++i) {
+    for (size_t j = 0; j <= i % 7; ++j) {
+      sketch.Add(hasher(std::to_string(i)));
+    }
+  }
+  for (size_t i = 0; i < 1000; ++i) {
+    EXPECT_LE(i % 7 + 1, sketch.Estimate(hasher(std::to_string(i))));
+  }
+}
+
+TEST(WordCounterTests, CountsExactlyWithoutSketch)
+{
+  WordCountStats stats;
+  auto counts = count_file("The cat's hat, the CAT.\nThe end\n",
+      WordCountOptions{}, &stats);
+
+  EXPECT_EQ(3, counts["the"]);
+  EXPECT_EQ(1, counts["cat's"]);
+  EXPECT_EQ(1, counts["cat"]);
+  EXPECT_EQ(1, counts["hat"]);
+  EXPECT_EQ(1, counts["end"]);
+  EXPECT_EQ(7, stats.tokens);
+  EXPECT_EQ(0, stats.tail_words);
+}
+
+TEST(WordCounterTests, KeepsFrequentWordsExactWithSketch)
+{
+  std::string text;
+  for (size_t i = 0; i < 200; ++i) {
+    // Digits are not part of words, so spell the number in letters.
+    text += "common rare";
+    text += static_cast<char>('a' + i / 26 % 26);
+    text += static_cast<char>('a' + i % 26);
+    text += " ";
+    if (i % 2 == 0) {
+      text += "often ";
+    }
+  }
+  WordCountOptions options;
+  options.sketch_width = 32;
+  options.sketch_depth = 3;
+  options.heavy_hitters = 2;
+  WordCountStats stats;
+  auto counts = count_file(text, options, &stats);
+
+  EXPECT_EQ(200, counts["common"]);
+  EXPECT_EQ(100, counts["often"]);
+  EXPECT_EQ(500, stats.tokens);
+  EXPECT_GT(stats.tail_words, 0);
+  for (const auto& count : counts) {
+    EXPECT_GE(count.second, 1) << count.first;
+  }
+}
+
+TEST(WordCounterTests, KeepsTheExactTableBoundedOnALongTail)
+{
+  // Every rare word has an estimate of one, so the admission count never
+  // rises and the table has to be cut back by rank alone.
+  std::string text;
+  for (size_t i = 0; i < 20000; ++i) {
+    for (size_t n = i; text.push_back(static_cast<char>('a' + n % 26)),
+        n >= 26; n /= 26) {
+    }
+    text += i % 10 == 0 ? " common " : " ";
+  }
+  WordCountOptions options;
+  options.sketch_width = 1 << 20;
+  options.sketch_depth = 2;
+  options.heavy_hitters = 50;
+  WordCountStats stats;
+  auto counts = count_file(text, options, &stats);
+
+  EXPECT_EQ(2000, counts["common"]);
+  EXPECT_EQ(20001, counts.size());
+  EXPECT_EQ(counts.size(), stats.heavy_words + stats.tail_words);
+  EXPECT_LE(stats.heavy_words, 2 * options.heavy_hitters);
+  EXPECT_LE(stats.peak_heavy_words, 2 * options.heavy_hitters + 1);
+  EXPECT_EQ(22000, stats.tokens);
+}